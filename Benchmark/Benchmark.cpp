@@ -0,0 +1,258 @@
+#include "pch.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "GameState.h"
+#include "C4Analysis.h"
+#include "MonteCarloTreeSearch.h"
+#include "Profiler.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+// Headless benchmark of the search: runs a fixed suite of positions with a fixed seed,
+// so numbers of two builds can be compared without the SDL window in the way.
+// Usage: MCTS_Benchmark [--iterations N] [--threads N] [--mode root|tree|leaf] [--rollouts N] [--seed N] [--no-tt] [--no-batch] [--solver N] [--report json|csv]
+// --solver N solves leaves with at most N empty cells exactly instead of playing them out, 0 turns the solver off.
+// --report prints the SearchReport of every position after the table, which also times the search phases
+
+namespace
+{
+	struct BenchmarkPosition
+	{
+		const char* Name;
+		// Columns played from the empty board, the first player starts
+		const char* Moves;
+	};
+
+	const std::vector<BenchmarkPosition> g_Positions{
+		{ "Empty board", "" },
+		{ "Opening", "3323" },
+		{ "Must block", "60616" },
+		{ "Win in one", "061626" },
+		{ "Midgame", "3324432554" },
+		{ "Late midgame", "333222444551100066" },
+		{ "Endgame", "42043323315652614615542221" }
+	};
+
+	struct BenchmarkResult
+	{
+		uint64_t NrIterations{ 0 };
+		uint64_t NrRollouts{ 0 };
+		uint32_t NrNodes{ 0 };
+		double Seconds{ 0.0 };
+		int Move{ INVALID_INDEX };
+		SearchReport Report{};
+	};
+
+	bool SetupPosition(const BenchmarkPosition& position, const C4_Analysis& rules, GameState& state)
+	{
+		for (const char* move{ position.Moves }; *move != '\0'; ++move)
+		{
+			const int column{ *move - '0' };
+			if (column < 0 || column >= state.GetNrColumns() || !rules.InProgress(state)
+				|| !state.PlacePiece(column, state.GetCurrentPlayer()))
+				return false;
+
+			// A won game is over, neither more moves nor a search make sense after it
+			if (rules.CheckWinAfterMove(state, column))
+				return false;
+		}
+		return rules.InProgress(state);
+	}
+
+	BenchmarkResult RunPosition(const GameState& state, const MCTSSettings& settings)
+	{
+		// A fresh search per position, nothing is reused between positions
+		MonteCarloTreeSearch<C4_Analysis> mcts{ nullptr, settings };
+
+		const auto start{ std::chrono::steady_clock::now() };
+		const int move{ mcts.FindNextMove(state) };
+		const auto end{ std::chrono::steady_clock::now() };
+
+		const SearchProgress progress{ mcts.GetProgress() };
+		BenchmarkResult result{};
+		result.NrIterations = progress.NrIterations;
+		result.NrRollouts = progress.NrRollouts;
+		result.NrNodes = progress.NrNodes;
+		result.Seconds = std::chrono::duration<double>(end - start).count();
+		result.Move = move;
+		result.Report = mcts.GetReport();
+		return result;
+	}
+
+	// Peak resident memory of the process in KiB, 0 when the platform doesn't tell
+	long GetPeakMemoryKiB()
+	{
+#if defined(__APPLE__)
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<long>(usage.ru_maxrss / 1024);
+#elif defined(__unix__)
+		rusage usage{};
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<long>(usage.ru_maxrss);
+#else
+		return 0;
+#endif
+	}
+
+	enum class ReportFormat
+	{
+		None,
+		Json,
+		Csv
+	};
+
+	bool ParseArguments(int argc, char* argv[], MCTSSettings& settings, ReportFormat& reportFormat)
+	{
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string argument{ argv[i] };
+			const bool has_value{ i + 1 < argc };
+			if (argument == "--iterations" && has_value)
+				settings.Limits.NrIterations = std::atoi(argv[++i]);
+			else if (argument == "--threads" && has_value)
+				settings.NrThreads = std::atoi(argv[++i]);
+			else if (argument == "--rollouts" && has_value)
+				settings.NrRollouts = std::atoi(argv[++i]);
+			else if (argument == "--seed" && has_value)
+				settings.Seed = std::strtoull(argv[++i], nullptr, 10);
+			else if (argument == "--no-tt")
+				settings.UseTranspositions = false;
+			else if (argument == "--no-batch")
+				settings.BatchRollouts = false;
+			else if (argument == "--solver" && has_value)
+				settings.SolverEmptyCells = std::atoi(argv[++i]);
+			else if (argument == "--report" && has_value)
+			{
+				const std::string format{ argv[++i] };
+				if (format == "json")
+					reportFormat = ReportFormat::Json;
+				else if (format == "csv")
+					reportFormat = ReportFormat::Csv;
+				else
+					return false;
+				settings.CollectReport = true;
+			}
+			else if (argument == "--mode" && has_value)
+			{
+				const std::string mode{ argv[++i] };
+				if (mode == "root")
+					settings.Parallelism = ParallelMode::Root;
+				else if (mode == "tree")
+					settings.Parallelism = ParallelMode::Tree;
+				else if (mode == "leaf")
+					settings.Parallelism = ParallelMode::Leaf;
+				else
+					return false;
+			}
+			else
+				return false;
+		}
+		return settings.Limits.NrIterations > 0;
+	}
+
+	const char* GetModeName(ParallelMode mode)
+	{
+		switch (mode)
+		{
+		case ParallelMode::Tree:
+			return "tree";
+		case ParallelMode::Leaf:
+			return "leaf";
+		default:
+			return "root";
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	MCTSSettings settings{};
+	settings.Limits.NrIterations = 20000;
+	settings.ReuseTree = false;
+	settings.Seed = 1;
+	ReportFormat report_format{ ReportFormat::None };
+	if (!ParseArguments(argc, argv, settings, report_format))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--iterations N] [--threads N] [--mode root|tree|leaf] [--rollouts N] [--seed N] [--no-tt] [--no-batch] [--solver N] [--report json|csv]\n";
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "MCTS benchmark: " << settings.Limits.NrIterations << " iterations, " << settings.NrThreads << " thread(s), "
+		<< GetModeName(settings.Parallelism) << " parallel, " << settings.NrRollouts << (settings.BatchRollouts ? " batched" : "") << " rollout(s) per leaf, "
+		<< (settings.UseTranspositions ? "transpositions on" : "transpositions off") << ", ";
+	if (settings.SolverEmptyCells > 0)
+		std::cout << "solver up to " << settings.SolverEmptyCells << " empty cells";
+	else
+		std::cout << "solver off";
+	std::cout << ", seed " << settings.Seed << "\n\n";
+
+	std::cout << std::left << std::setw(16) << "Position" << std::right
+		<< std::setw(12) << "Iterations" << std::setw(10) << "Time(ms)" << std::setw(14) << "Iterations/s"
+		<< std::setw(14) << "Rollouts/s" << std::setw(10) << "Nodes" << std::setw(6) << "Move" << '\n';
+
+	const C4_Analysis rules{};
+	BenchmarkResult total{};
+	std::vector<SearchReport> reports{};
+	for (const BenchmarkPosition& position : g_Positions)
+	{
+		GameState state{ 'X', 'O' };
+		if (!SetupPosition(position, rules, state))
+		{
+			std::cerr << "Invalid benchmark position: " << position.Name << '\n';
+			return EXIT_FAILURE;
+		}
+
+		const BenchmarkResult result{ RunPosition(state, settings) };
+		std::cout << std::left << std::setw(16) << position.Name << std::right << std::fixed << std::setprecision(0)
+			<< std::setw(12) << result.NrIterations << std::setw(10) << result.Seconds * 1000.0
+			<< std::setw(14) << result.NrIterations / result.Seconds << std::setw(14) << result.NrRollouts / result.Seconds
+			<< std::setw(10) << result.NrNodes << std::setw(6) << result.Move << '\n';
+
+		total.NrIterations += result.NrIterations;
+		total.NrRollouts += result.NrRollouts;
+		total.NrNodes += result.NrNodes;
+		total.Seconds += result.Seconds;
+		reports.push_back(result.Report);
+	}
+
+	std::cout << std::left << std::setw(16) << "Total" << std::right
+		<< std::setw(12) << total.NrIterations << std::setw(10) << total.Seconds * 1000.0
+		<< std::setw(14) << total.NrIterations / total.Seconds << std::setw(14) << total.NrRollouts / total.Seconds
+		<< std::setw(10) << total.NrNodes << '\n';
+
+	std::cout << "\nNodes allocated: " << total.NrNodes << " (" << total.NrNodes * sizeof(MCTSNode) / 1024 << " KiB of nodes)\n";
+	const long peak_memory{ GetPeakMemoryKiB() };
+	if (peak_memory > 0)
+		std::cout << "Peak memory: " << peak_memory << " KiB\n";
+	else
+		std::cout << "Peak memory: n/a\n";
+
+#ifdef MCTS_PROFILING
+	std::cout << '\n' << Profiler::Report();
+#endif
+
+	if (report_format != ReportFormat::None)
+	{
+		std::cout << '\n';
+		if (report_format == ReportFormat::Csv)
+			std::cout << "position," << SearchReport::GetCsvHeader() << '\n';
+
+		for (size_t i{ 0 }; i < reports.size(); ++i)
+		{
+			if (report_format == ReportFormat::Csv)
+				std::cout << '"' << g_Positions[i].Name << "\"," << reports[i].ToCsv() << '\n';
+			else
+				std::cout << reports[i].ToJson() << '\n';
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+#include "pch.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include "GameState.h"
+#include "BitBoardState.h"
+#include "C4Analysis.h"
+
+// Perft for Connect 4: counts every move sequence of exactly the given depth from a position, games that are won
+// before that depth are cut off. The counts only depend on the rules, so they check PlacePiece, GetAvailableActions
+// and CheckWin of every board backend against known values and against each other, and the time it takes
+// measures the rules without anything of the search in the way.
+// Every position up to the depth, at most MaxEvaluationCheckDepth, is also evaluated with and without the incremental
+// evaluation of GameState, CheckWin and EvaluatePosition have to give the same answer both ways.
+// Usage: MCTS_Perft [depth] [--moves COLUMNS]
+
+namespace
+{
+	// Perft of the empty board, the missing sequences at depth 7 are the ones that try a 7th piece in one column
+	constexpr std::array<uint64_t, 11> g_KnownCounts{
+		1, 7, 49, 343, 2401, 16807, 117649, 823536, 5673234, 39394572, 268031646
+	};
+
+	struct PerftResult
+	{
+		uint64_t NrLeaves{ 0 };
+		// Every position made on the way, leaves included
+		uint64_t NrNodes{ 0 };
+	};
+
+	template<typename State>
+	void Perft(const State& state, const C4_Analysis& rules, int depth, PerftResult& result)
+	{
+		const char mover{ state.GetCurrentPlayer() };
+		for (const int move : rules.GetAvailableActions(state))
+		{
+			State child{ state };
+			child.PlacePiece(move, mover);
+			++result.NrNodes;
+
+			if (depth == 1)
+				++result.NrLeaves;
+			else if (!rules.CheckWin(child, mover))
+				Perft(child, rules, depth - 1, result);
+		}
+	}
+
+	// Evaluating every position twice is much slower than perft itself, depth 6 already covers over 100000 positions
+	constexpr int MaxEvaluationCheckDepth{ 6 };
+
+	struct EvaluationCheck
+	{
+		uint64_t NrPositions{ 0 };
+		uint64_t NrMismatches{ 0 };
+	};
+
+	// Walks the same tree as Perft with two copies of every position, the second one keeping its evaluation
+	// up to date while pieces are placed, and compares what the rules make of both
+	void CheckEvaluation(const GameState& plain, const GameState& evaluated, const C4_Analysis& rules, int depth, EvaluationCheck& check)
+	{
+		++check.NrPositions;
+		for (const char player : { plain.GetP1Piece(), plain.GetP2Piece() })
+		{
+			const char opponent{ player == plain.GetP1Piece() ? plain.GetP2Piece() : plain.GetP1Piece() };
+			if (rules.CheckWin(plain, player) != rules.CheckWin(evaluated, player)
+				|| rules.EvaluatePosition(plain, player, opponent) != rules.EvaluatePosition(evaluated, player, opponent))
+			{
+				++check.NrMismatches;
+				break;
+			}
+		}
+
+		if (depth == 0)
+			return;
+
+		const char mover{ plain.GetCurrentPlayer() };
+		for (const int move : rules.GetAvailableActions(plain))
+		{
+			GameState plain_child{ plain };
+			plain_child.PlacePiece(move, mover);
+			GameState evaluated_child{ evaluated };
+			evaluated_child.PlacePiece(move, mover);
+
+			// A won game has no moves left, but the position itself is checked
+			CheckEvaluation(plain_child, evaluated_child, rules, rules.CheckWin(plain_child, mover) ? 0 : depth - 1, check);
+		}
+	}
+
+	template<typename State>
+	uint64_t RunPerft(const char* name, const State& state, const C4_Analysis& rules, int depth)
+	{
+		PerftResult result{};
+		const auto start{ std::chrono::steady_clock::now() };
+		if (depth == 0)
+			result.NrLeaves = 1;
+		else
+			Perft(state, rules, depth, result);
+		const double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+
+		std::cout << std::left << std::setw(16) << name << std::right << std::setw(14) << result.NrLeaves
+			<< std::setw(12) << std::fixed << std::setprecision(0) << seconds * 1000.0
+			<< std::setw(16) << (seconds > 0.0 ? result.NrNodes / seconds : 0.0) << '\n';
+		return result.NrLeaves;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int depth{ 8 };
+	std::string moves{};
+	for (int i{ 1 }; i < argc; ++i)
+	{
+		const std::string argument{ argv[i] };
+		if (argument == "--moves" && i + 1 < argc)
+			moves = argv[++i];
+		else if (!argument.empty() && argument.find_first_not_of("0123456789") == std::string::npos)
+			depth = std::atoi(argument.c_str());
+		else
+		{
+			std::cerr << "Usage: " << argv[0] << " [depth] [--moves COLUMNS]\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	const C4_Analysis rules{};
+	GameState state{ 'X', 'O' };
+	bool is_won{ false };
+	for (const char move : moves)
+	{
+		// Moves after a win don't belong to the game
+		const int column{ move - '0' };
+		if (is_won || column < 0 || column >= state.GetNrColumns() || !rules.InProgress(state)
+			|| !state.PlacePiece(column, state.GetCurrentPlayer()))
+		{
+			std::cerr << "Invalid moves: " << moves << '\n';
+			return EXIT_FAILURE;
+		}
+		is_won = rules.CheckWinAfterMove(state, column);
+	}
+	if (is_won || !rules.InProgress(state))
+	{
+		std::cerr << "The game is already over after " << moves << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "Perft depth " << depth << (moves.empty() ? " from the empty board" : " after " + moves) << "\n\n";
+	std::cout << std::left << std::setw(16) << "Backend" << std::right << std::setw(14) << "Leaves"
+		<< std::setw(12) << "Time(ms)" << std::setw(16) << "Nodes/s" << '\n';
+
+	const uint64_t nr_leaves{ RunPerft("GameState", state, rules, depth) };
+	const uint64_t nr_bitboard_leaves{ RunPerft("BitBoardState", BitBoardState{ state }, rules, depth) };
+
+	GameState evaluated_state{ state };
+	evaluated_state.EnableEvaluation();
+	EvaluationCheck check{};
+	const int check_depth{ std::min(depth, MaxEvaluationCheckDepth) };
+	CheckEvaluation(state, evaluated_state, rules, check_depth, check);
+
+	// The backends have to agree on every position, the empty board also has known counts
+	bool is_correct{ nr_leaves == nr_bitboard_leaves && check.NrMismatches == 0 };
+	if (nr_leaves != nr_bitboard_leaves)
+		std::cout << "\nThe backends disagree\n";
+	if (check.NrMismatches == 0)
+		std::cout << "\nThe incremental evaluation matches on all " << check.NrPositions << " positions up to depth " << check_depth << '\n';
+	else
+		std::cout << "\nThe incremental evaluation differs on " << check.NrMismatches << " of " << check.NrPositions << " positions up to depth " << check_depth << '\n';
+	if (moves.empty() && depth < static_cast<int>(g_KnownCounts.size()))
+	{
+		const uint64_t expected{ g_KnownCounts[depth] };
+		is_correct &= nr_leaves == expected && nr_bitboard_leaves == expected;
+		std::cout << (nr_leaves == expected && nr_bitboard_leaves == expected ? "\nMatches the known count " : "\nWRONG, the known count is ")
+			<< expected << '\n';
+	}
+
+	return is_correct ? EXIT_SUCCESS : EXIT_FAILURE;
+}
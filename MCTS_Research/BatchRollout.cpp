@@ -0,0 +1,232 @@
+#include "pch.h"
+#include "BatchRollout.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include "C4Analysis.h"
+
+// The AVX2 code is always compiled on x86 and only used when the CPU supports it, so one build runs everywhere
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define MCTS_BATCH_X86
+#define MCTS_BATCH_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define MCTS_BATCH_X86
+#define MCTS_BATCH_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace
+{
+	constexpr int NrCells{ BitBoardState::NrRows * BitBoardState::NrColumns };
+
+	// Boards of one batch as structure of arrays, every lane is one game
+	struct alignas(32) Lanes
+	{
+		// Pieces of the player to move, and the pieces of both players
+		std::array<uint64_t, BatchRollout::BatchSize> Pieces{};
+		std::array<uint64_t, BatchRollout::BatchSize> Mask{};
+		// Bottom cell of the column the game plays this ply, 0 for games that are over
+		std::array<uint64_t, BatchRollout::BatchSize> Move{};
+	};
+
+	constexpr uint64_t GetTopRow()
+	{
+		uint64_t top_row{ 0 };
+		for (int column{ 0 }; column < BitBoardState::NrColumns; ++column)
+			top_row |= BitBoardState::CellMask(BitBoardState::NrRows - 1, column);
+		return top_row;
+	}
+	// A column is full once its top cell is taken
+	constexpr uint64_t TopRow{ GetTopRow() };
+
+	// The top cells are NrRows + 1 bits apart, multiplying by this lines them up as 7 bits from bit 36 on.
+	// No two partial products land on the same bit, so nothing carries into those 7 bits
+	constexpr uint64_t GetGatherFactor()
+	{
+		uint64_t factor{ 0 };
+		for (int column{ 0 }; column < BitBoardState::NrColumns; ++column)
+			factor |= uint64_t{ 1 } << (36 - 6 * column);
+		return factor;
+	}
+	constexpr uint64_t GatherFactor{ GetGatherFactor() };
+
+	// The n-th set bit of every 7 bit column set, so picking a column doesn't need a loop that mispredicts
+	constexpr std::array<std::array<uint8_t, BitBoardState::NrColumns>, 128> GetNthColumns()
+	{
+		std::array<std::array<uint8_t, BitBoardState::NrColumns>, 128> nth_columns{};
+		for (int columns{ 0 }; columns < 128; ++columns)
+		{
+			int n{ 0 };
+			for (int column{ 0 }; column < BitBoardState::NrColumns; ++column)
+			{
+				if (columns & (1 << column))
+					nth_columns[columns][n++] = static_cast<uint8_t>(column);
+			}
+		}
+		return nth_columns;
+	}
+	constexpr std::array<std::array<uint8_t, BitBoardState::NrColumns>, 128> NthColumns{ GetNthColumns() };
+
+	// Sets the bottom cell of a random column that isn't full as move of every playing lane.
+	// Every random number is split in two 32 bit halves, one per lane. Scaling them to the number of columns
+	// without rejecting has a bias of at most 7 in 2^32, far below what a rollout can notice
+	void PickMoves(Lanes& lanes, uint32_t playing, RandomEngine& random)
+	{
+		uint64_t random_bits{ 0 };
+		for (int lane{ 0 }; lane < BatchRollout::BatchSize; ++lane)
+		{
+			if (lane % 2 == 0)
+				random_bits = random.Next();
+			else
+				random_bits >>= 32;
+
+			if ((playing & (1u << lane)) == 0)
+			{
+				lanes.Move[lane] = 0;
+				continue;
+			}
+
+			const uint64_t free_tops{ ~lanes.Mask[lane] & TopRow };
+			const uint32_t free_columns{ static_cast<uint32_t>((((free_tops >> (BitBoardState::NrRows - 1)) * GatherFactor) >> 36) & 0x7F) };
+			const uint64_t pick{ ((random_bits & 0xFFFFFFFFull) * static_cast<uint64_t>(std::popcount(free_columns))) >> 32 };
+			lanes.Move[lane] = BitBoardState::BottomMask(NthColumns[free_columns][pick]);
+		}
+	}
+
+	// Adding the bottom cell of a column to the mask carries into the lowest empty cell of that column.
+	// Returns a bit for every lane whose move made four in a row
+	uint32_t DropScalar(Lanes& lanes)
+	{
+		uint32_t won{ 0 };
+		for (int lane{ 0 }; lane < BatchRollout::BatchSize; ++lane)
+		{
+			const uint64_t new_mask{ lanes.Mask[lane] | (lanes.Mask[lane] + lanes.Move[lane]) };
+			const uint64_t mover_pieces{ lanes.Pieces[lane] | (new_mask ^ lanes.Mask[lane]) };
+			if (C4_Analysis::HasFourInARow(mover_pieces))
+				won |= 1u << lane;
+
+			// The opponent moves next
+			lanes.Pieces[lane] = mover_pieces ^ new_mask;
+			lanes.Mask[lane] = new_mask;
+		}
+		return won;
+	}
+
+#ifdef MCTS_BATCH_X86
+	MCTS_BATCH_TARGET_AVX2 __m256i FourInDirection(__m256i pieces, int direction)
+	{
+		const __m256i pairs{ _mm256_and_si256(pieces, _mm256_srl_epi64(pieces, _mm_cvtsi32_si128(direction))) };
+		return _mm256_and_si256(pairs, _mm256_srl_epi64(pairs, _mm_cvtsi32_si128(2 * direction)));
+	}
+
+	// Same as DropScalar, four lanes per instruction
+	MCTS_BATCH_TARGET_AVX2 uint32_t DropAvx2(Lanes& lanes)
+	{
+		uint32_t won{ 0 };
+		for (int first_lane{ 0 }; first_lane < BatchRollout::BatchSize; first_lane += 4)
+		{
+			const __m256i mask{ _mm256_load_si256(reinterpret_cast<const __m256i*>(&lanes.Mask[first_lane])) };
+			const __m256i pieces{ _mm256_load_si256(reinterpret_cast<const __m256i*>(&lanes.Pieces[first_lane])) };
+			const __m256i move{ _mm256_load_si256(reinterpret_cast<const __m256i*>(&lanes.Move[first_lane])) };
+
+			const __m256i new_mask{ _mm256_or_si256(mask, _mm256_add_epi64(mask, move)) };
+			const __m256i mover_pieces{ _mm256_or_si256(pieces, _mm256_xor_si256(new_mask, mask)) };
+
+			__m256i four{ FourInDirection(mover_pieces, 1) };
+			four = _mm256_or_si256(four, FourInDirection(mover_pieces, BitBoardState::ColumnHeight));
+			four = _mm256_or_si256(four, FourInDirection(mover_pieces, BitBoardState::ColumnHeight - 1));
+			four = _mm256_or_si256(four, FourInDirection(mover_pieces, BitBoardState::ColumnHeight + 1));
+			const __m256i no_four{ _mm256_cmpeq_epi64(four, _mm256_setzero_si256()) };
+			won |= (~static_cast<uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(no_four))) & 0xFu) << first_lane;
+
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&lanes.Pieces[first_lane]), _mm256_xor_si256(mover_pieces, new_mask));
+			_mm256_store_si256(reinterpret_cast<__m256i*>(&lanes.Mask[first_lane]), new_mask);
+		}
+		return won;
+	}
+#endif
+
+	bool DetectAvx2()
+	{
+#if defined(MCTS_BATCH_X86) && defined(_MSC_VER)
+		int info[4]{};
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+
+		// The OS has to save the AVX registers as well
+		__cpuid(info, 1);
+		const bool has_avx{ (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6 };
+		__cpuidex(info, 7, 0);
+		return has_avx && (info[1] & (1 << 5)) != 0;
+#elif defined(MCTS_BATCH_X86)
+		return __builtin_cpu_supports("avx2");
+#else
+		return false;
+#endif
+	}
+}
+
+void BatchRollout::Play(const BitBoardState& state, RandomEngine& random, char* winners, int nrGames)
+{
+	[[maybe_unused]] const bool use_avx2{ IsUsingAvx2() };
+
+	// Every lane plays games one after the other, a lane whose game ends starts the next one right away
+	// so no lane idles while the others finish their longer games
+	Lanes lanes{};
+	std::array<int, BatchSize> lane_games{};
+	std::array<int, BatchSize> lane_nr_pieces{};
+	int next_game{ 0 };
+	uint32_t playing{ 0 };
+	auto start_game = [&](int lane)
+		{
+			if (next_game == nrGames)
+			{
+				playing &= ~(1u << lane);
+				return;
+			}
+
+			lanes.Pieces[lane] = state.GetPieces(state.GetCurrentPlayer());
+			lanes.Mask[lane] = state.GetMask();
+			lane_games[lane] = next_game++;
+			lane_nr_pieces[lane] = state.GetNrPieces();
+			playing |= 1u << lane;
+		};
+
+	for (int lane{ 0 }; lane < BatchSize; ++lane)
+		start_game(lane);
+
+	while (playing != 0)
+	{
+		PickMoves(lanes, playing, random);
+
+#ifdef MCTS_BATCH_X86
+		const uint32_t won{ use_avx2 ? DropAvx2(lanes) : DropScalar(lanes) };
+#else
+		const uint32_t won{ DropScalar(lanes) };
+#endif
+
+		for (uint32_t lanes_left{ playing }; lanes_left != 0; lanes_left &= lanes_left - 1)
+		{
+			const int lane{ std::countr_zero(lanes_left) };
+			const bool is_win{ (won & (1u << lane)) != 0 };
+			if (!is_win && ++lane_nr_pieces[lane] < NrCells)
+				continue;
+
+			// Without the move that won, an even number of pieces means the first player made it
+			if (is_win)
+				winners[lane_games[lane]] = (lane_nr_pieces[lane] & 1) == 0 ? state.GetP1Piece() : state.GetP2Piece();
+			else
+				winners[lane_games[lane]] = EMPTY;
+			start_game(lane);
+		}
+	}
+}
+
+bool BatchRollout::IsUsingAvx2()
+{
+	static const bool has_avx2{ DetectAvx2() };
+	return has_avx2;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <cstdint>
+#include "BitBoardState.h"
+#include "RandomEngine.h"
+
+// Plays random Connect 4 games from one position in lockstep. The boards of a batch are kept as structure of arrays,
+// so dropping the pieces and looking for four in a row is done for several games per instruction,
+// with AVX2 when the CPU has it and plain 64 bit code otherwise.
+// It plays by the standard Connect 4 rules itself, without going through a rules policy.
+namespace BatchRollout
+{
+	// Games advanced together, two AVX2 vectors of four boards
+	constexpr int BatchSize{ 8 };
+
+	// Plays nrGames random games from state and writes the winner of each to winners, EMPTY for a draw.
+	// The game in state must not be over yet
+	void Play(const BitBoardState& state, RandomEngine& random, char* winners, int nrGames);
+
+	bool IsUsingAvx2();
+}
@@ -0,0 +1,80 @@
+#include "pch.h"
+#include "BitBoardState.h"
+#include "GameState.h"
+#include "Zobrist.h"
+#include <iostream>
+
+BitBoardState::BitBoardState()
+    : BitBoardState(EMPTY, EMPTY)
+{
+}
+
+BitBoardState::BitBoardState(char player1, char player2)
+    : m_Player1{ player1 }
+    , m_Player2{ player2 }
+{
+}
+
+BitBoardState::BitBoardState(const GameState& state)
+    : m_LastMove{ state.GetLastMove() }
+    , m_NrPieces{ state.GetNrPieces() }
+    , m_Hash{ state.GetHash() }
+    , m_Player1{ state.GetP1Piece() }
+    , m_Player2{ state.GetP2Piece() }
+{
+    for (int row{ 0 }; row < NrRows; ++row)
+    {
+        for (int col{ 0 }; col < NrColumns; ++col)
+        {
+            const char cell{ state.GetCell(row, col) };
+            if (cell == EMPTY)
+                continue;
+
+            m_Pieces[cell == m_Player1 ? 0 : 1] |= CellMask(row, col);
+            ++m_Heights[col];
+        }
+    }
+}
+
+void BitBoardState::Reset()
+{
+    m_Pieces = {};
+    m_Heights = {};
+    m_NrPieces = 0;
+    m_Hash = 0;
+    m_LastMove = INVALID_INDEX;
+}
+
+bool BitBoardState::PlacePiece(const int& column, const char& player)
+{
+    // Catch player on wrong turn
+    if (player != GetCurrentPlayer())
+    {
+        std::cerr << "NOT YOUR TURN!\n";
+        return false;
+    }
+
+    // Check if the column exists and isn't full
+    if (column < 0 || column >= NrColumns || !CanPlay(column))
+        return false;
+
+    // The lowest empty cell of the column is the column's bottom bit shifted by its height
+    m_Pieces[m_NrPieces & 1] |= BottomMask(column) << m_Heights[column];
+    m_Hash ^= Zobrist::GetKey(m_NrPieces & 1, m_Heights[column], column);
+    ++m_Heights[column];
+
+    m_LastMove = column;
+    ++m_NrPieces;
+
+    return true;
+}
+
+char BitBoardState::GetCell(int row, int column) const
+{
+    const uint64_t cell{ CellMask(row, column) };
+    if (m_Pieces[0] & cell)
+        return m_Player1;
+    if (m_Pieces[1] & cell)
+        return m_Player2;
+    return EMPTY;
+}
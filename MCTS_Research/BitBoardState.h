@@ -0,0 +1,65 @@
+#pragma once
+#include "StateAnalysis.h"
+#include <array>
+#include <cstdint>
+
+class GameState;
+
+// Connect 4 position stored as one bitboard per player.
+// Every column takes NrRows + 1 bits (the extra bit is a sentinel so pieces never wrap into the next column),
+// bit index = column * ColumnHeight + row, row 0 being the bottom row like in GameState.
+class BitBoardState
+{
+public:
+	static constexpr int NrRows{ 6 };
+	static constexpr int NrColumns{ 7 };
+	static constexpr int ColumnHeight{ NrRows + 1 };
+
+	BitBoardState();
+	BitBoardState(char player1, char player2);
+	explicit BitBoardState(const GameState& state);
+
+	void Reset();
+
+	bool PlacePiece(const int& column, const char& player);
+	bool CanPlay(int column) const { return m_Heights[column] < NrRows; };
+
+	// Adapter to the char grid used by GameState (rendering, debugging)
+	char GetCell(int row, int column) const;
+
+	//Getters
+	uint64_t GetPieces(const char& player) const { return m_Pieces[player == m_Player1 ? 0 : 1]; };
+	uint64_t GetMask() const { return m_Pieces[0] | m_Pieces[1]; };
+	int GetHeight(int column) const { return m_Heights[column]; };
+	int GetLastMove() const { return m_LastMove; };
+	// Zobrist hash, the same as GameState::GetHash for the same position
+	uint64_t GetHash() const { return m_Hash; };
+	int GetNrRows() const { return NrRows; };
+	int GetNrColumns() const { return NrColumns; };
+	int GetNrPieces() const { return m_NrPieces; };
+	char GetP1Piece() const { return m_Player1; };
+	char GetP2Piece() const { return m_Player2; };
+	bool IsPlayer1Turn() const { return (m_NrPieces & 1) == 0; };
+	bool IsPlayerTurn(const char& player) const { return player == GetCurrentPlayer(); };
+	char GetCurrentPlayer() const { return IsPlayer1Turn() ? m_Player1 : m_Player2; };
+	char GetWaitingPlayer() const { return IsPlayer1Turn() ? m_Player2 : m_Player1; };
+	char GetOpponentPiece(const char& myPiece) const { return myPiece == m_Player1 ? m_Player2 : m_Player1; };
+
+	// Same pieces on the same cells, which also means the same player is to move
+	friend bool operator==(const BitBoardState& lhs, const BitBoardState& rhs)
+	{
+		return lhs.m_Pieces == rhs.m_Pieces;
+	}
+
+	static constexpr uint64_t BottomMask(int column) { return uint64_t{ 1 } << (column * ColumnHeight); };
+	static constexpr uint64_t CellMask(int row, int column) { return uint64_t{ 1 } << (column * ColumnHeight + row); };
+	static constexpr uint64_t ColumnMask(int column) { return ((uint64_t{ 1 } << NrRows) - 1) << (column * ColumnHeight); };
+private:
+	std::array<uint64_t, 2> m_Pieces{};
+	std::array<uint8_t, NrColumns> m_Heights{};
+	int m_LastMove{ INVALID_INDEX };
+	int m_NrPieces{ 0 };
+	uint64_t m_Hash{ 0 };
+	char m_Player1;
+	char m_Player2;
+};
@@ -61,7 +61,7 @@ void Board::Render() const
         for (int col = 0; col < GetNrColumns(); ++col)
         {
             // Use color of correct players piece
-            char cell_occupation{ m_Board[row][col] };
+            char cell_occupation{ GetCell(row, col) };
 
             if (cell_occupation == m_pPlayer1->GetInitial())
                 piece_color = m_pPlayer1->GetColor();
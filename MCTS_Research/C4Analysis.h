@@ -1,5 +1,13 @@
 #pragma once
 #include "StateAnalysis.h"
+#include "GameState.h"
+#include "BitBoardState.h"
+#include "Profiler.h"
+#include "WinningLines.h"
+#include <algorithm>
+#include <bit>
+#include <initializer_list>
+#include <utility>
 
 struct C4_Analysis final : public StateAnalysis
 {
@@ -24,7 +32,7 @@ struct C4_Analysis final : public StateAnalysis
 
 	};
 
-	enum class Orientation { Horizontal, Vertical, Ascending, Descending };
+	using Orientation = WinningLines::Orientation;
 	struct Chain
 	{
 		BoardPosition start;
@@ -32,20 +40,21 @@ struct C4_Analysis final : public StateAnalysis
 		Orientation orientation;
 	};
 
-	virtual bool StateAnalysis::InProgress(const GameState& state) const override
+	virtual bool InProgress(const GameState& state) const override
 	{
 		return state.GetNrPieces() < state.GetNrColumns() * state.GetNrRows();
 	}
 
 
-	virtual std::vector<int> StateAnalysis::GetAvailableActions(const GameState& state) const override
+	virtual MoveList GetAvailableActions(const GameState& state) const override
 	{
-		std::vector<int> availableActions{};
+		MCTS_PROFILE_SCOPE(ProfileZone::GetAvailableActions);
+		MoveList availableActions{};
 
 		for (int col = 0; col < state.GetNrColumns(); ++col)
 		{
 			// Check if the column is empty.
-			if (state.GetBoard()[state.GetNrRows() - 1][col] == EMPTY)
+			if (state.GetCell(state.GetNrRows() - 1, col) == EMPTY)
 			{
 				availableActions.push_back(col);
 			}
@@ -55,142 +64,120 @@ struct C4_Analysis final : public StateAnalysis
 	}
 
 
-	bool CheckPiecesInAHorizontalRow(const GameState& state, const char& player, int piecesInARow) const
+	virtual bool CheckWin(const GameState& state, const char& player) const override
 	{
-		// Check if connected horizontally
-		for (int row = 0; row < state.GetNrRows(); row++) {
-			for (int col = 0; col < state.GetNrColumns() - piecesInARow + 1; col++)
-			{
-				bool connected{ true };
-				for (int i = 0; i < piecesInARow; i++) {
-					if (state.GetBoard()[row][col + i] != player) {
-						connected = false;
-						break;
-					}
-				}
-
-				if (connected)
-					return true;
-			}
-		}
+		MCTS_PROFILE_SCOPE(ProfileZone::CheckWin);
+		if (const EvaluationAccumulator* pEvaluation{ state.GetEvaluation() })
+			return pEvaluation->HasFourInARow(player == state.GetP1Piece() ? 0 : 1);
 
-		return false;
+		return HasFourInARow(GetPieceMasks(state, player).first);
 	}
 
-
-	bool CheckPiecesInAVerticalRow(const GameState& state, const char& player, int piecesInARow) const
+	virtual bool CheckWinAfterMove(const GameState& state, int column) const override
 	{
-		// Check if connected vertically
-		for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-			for (int col = 0; col < state.GetNrColumns(); col++)
-			{
-				bool connected{ true };
-				for (int i = 0; i < piecesInARow; i++)
-				{
-					if (state.GetBoard()[row + i][col] != player)
-					{
-						connected = false;
-						break;
-					}
-				}
+		MCTS_PROFILE_SCOPE(ProfileZone::CheckWin);
+		// Find the piece that was just dropped in the column
+		int row{ state.GetNrRows() - 1 };
+		while (row >= 0 && state.GetCell(row, column) == EMPTY)
+			--row;
 
-				if (connected)
-					return true;
-			}
+		if (row < 0)
+			return false;
+
+		// Only the lines through that piece can have been completed by it
+		const char player{ state.GetCell(row, column) };
+		for (const int line : WinningLines::GetLinesThrough(row, column))
+		{
+			const std::array<WinningLines::Cell, 4>& cells{ WinningLines::Lines[line].Cells };
+			if (std::all_of(cells.begin(), cells.end(), [&state, player](const WinningLines::Cell& cell)
+				{
+					return state.GetCell(cell.Row, cell.Column) == player;
+				}))
+				return true;
 		}
 
 		return false;
 	}
 
+	virtual bool CheckDraw(const GameState& state) const override
+	{
+		MCTS_PROFILE_SCOPE(ProfileZone::CheckDraw);
+		return state.GetNrPieces() == state.GetNrColumns() * state.GetNrRows();
+	}
 
+	// Bitboard overloads, used by the search hot path
+	virtual bool InProgress(const BitBoardState& state) const override
+	{
+		return state.GetNrPieces() < BitBoardState::NrColumns * BitBoardState::NrRows;
+	}
 
-	bool CheckPiecesInADiagonalRow(const GameState& state, const char& player, int piecesInARow, bool ascending) const
+	virtual MoveList GetAvailableActions(const BitBoardState& state) const override
 	{
-		if (ascending)
-		{
-			// Check if connected diagonally (top-right to bottom-left)
-			for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-				for (int col = 0; col < state.GetNrColumns() - piecesInARow + 1; col++)
-				{
-					bool connected{ true };
-
-					for (int i = 0; i < piecesInARow; i++)
-					{
-						if (state.GetBoard()[row + i][col + i] != player)
-						{
-							connected = false;
-							break;
-						}
-					}
-
-					if (connected)
-						return true;
-				}
-			}
-		}
-		else
+		MCTS_PROFILE_SCOPE(ProfileZone::GetAvailableActions);
+		MoveList availableActions{};
+
+		for (int col = 0; col < BitBoardState::NrColumns; ++col)
 		{
-			// Check if connected diagonally (top-right to bottom-left)
-			for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-				for (int col = piecesInARow - 1; col < state.GetNrColumns(); col++)
-				{
-					bool connected{ true };
-
-					for (int i = 0; i < piecesInARow; i++)
-					{
-						if (state.GetBoard()[row + i][col - i] != player)
-						{
-							connected = false;
-							break;
-						}
-					}
-
-					if (connected)
-						return true;
-				}
-			}
+			if (state.CanPlay(col))
+				availableActions.push_back(col);
 		}
-		return false;
-	}
 
+		return availableActions;
+	}
 
-	bool CheckPiecesInARow(const GameState& state, const char& player, int piecesInARow) const
+	// For each direction, and-ing the pieces with themselves shifted by one cell
+	// and then the resulting pairs shifted by two cells leaves a bit only where four pieces line up.
+	static bool HasFourInARow(uint64_t pieces)
 	{
-		// Check if connected horizontally
-		if (CheckPiecesInAHorizontalRow(state, player, piecesInARow))
-			return true;
-
-		if (CheckPiecesInAVerticalRow(state, player, piecesInARow))
-			return true;
-
-		if (CheckPiecesInADiagonalRow(state, player, piecesInARow, false))
-			return true;
+		constexpr int directions[]{
+			1,									// vertical
+			BitBoardState::ColumnHeight,		// horizontal
+			BitBoardState::ColumnHeight - 1,	// descending diagonal
+			BitBoardState::ColumnHeight + 1 };	// ascending diagonal
 
-		if (CheckPiecesInADiagonalRow(state, player, piecesInARow, true))
-			return true;
+		for (const int direction : directions)
+		{
+			const uint64_t pairs{ pieces & (pieces >> direction) };
+			if (pairs & (pairs >> (2 * direction)))
+				return true;
+		}
 
 		return false;
 	}
 
-	virtual bool StateAnalysis::CheckWin(const GameState& state, const char& player) const override
+	virtual bool CheckWin(const BitBoardState& state, const char& player) const override
 	{
-		return CheckPiecesInARow(state, player, 4);
+		MCTS_PROFILE_SCOPE(ProfileZone::CheckWin);
+		return HasFourInARow(state.GetPieces(player));
 	}
 
-	virtual bool StateAnalysis::CheckDraw(const GameState& state) const override
+	virtual bool CheckWinAfterMove(const BitBoardState& state, int column) const override
 	{
-		return state.GetNrPieces() == state.GetNrColumns() * state.GetNrRows();
+		MCTS_PROFILE_SCOPE(ProfileZone::CheckWin);
+		// Only the player owning the top piece of the column can have completed a line with it
+		const int height{ state.GetHeight(column) };
+		if (height == 0)
+			return false;
+
+		const char player{ state.GetCell(height - 1, column) };
+		return HasFourInARow(state.GetPieces(player));
+	}
+
+	virtual bool CheckDraw(const BitBoardState& state) const override
+	{
+		MCTS_PROFILE_SCOPE(ProfileZone::CheckDraw);
+		return state.GetNrPieces() == BitBoardState::NrColumns * BitBoardState::NrRows;
 	}
 
 	bool IsEmptyWitFullCellBelow(const GameState& state, int row, int column) const
 	{
 		//Check if cell is empty
-		if (state.GetBoard()[row][column] != EMPTY) {
+		if (state.GetCell(row, column) != EMPTY) {
 			return false;
 		}
 
 		//Check if cell below is full
-		if (row - 1 < 0 || state.GetBoard()[row - 1][column] != EMPTY)
+		if (row - 1 < 0 || state.GetCell(row - 1, column) != EMPTY)
 			return true;
 
 		return false;
@@ -199,357 +186,162 @@ struct C4_Analysis final : public StateAnalysis
 
 
 
-	std::pair<BoardPosition, BoardPosition> GetHorizontalChainStartAndEnd(const GameState& state, const char& player, int piecesInARow) const
+	// The pieces of player and the pieces of the other player, in the bitboard layout of BitBoardState
+	static std::pair<uint64_t, uint64_t> GetPieceMasks(const GameState& state, const char& player)
 	{
-		BoardPosition startPos{ -1, -1 };
-		BoardPosition endPos{ -1,-1 };
-
-		// Check if connected horizontally
+		uint64_t pieces{ 0 };
+		uint64_t opponent_pieces{ 0 };
 		for (int row = 0; row < state.GetNrRows(); row++) {
-			for (int col = 0; col < state.GetNrColumns() - piecesInARow + 1; col++)
+			for (int col = 0; col < state.GetNrColumns(); col++)
 			{
-				bool connected{ true };
-				startPos.row = row;
-				startPos.column = col;
-
-				for (int i = 0; i < piecesInARow; i++)
-				{
-					if (state.GetBoard()[row][col + i] != player)
-					{
-						connected = false;
-						break;
-					}
-				}
-
-				if (connected)
-				{
-					endPos.row = row;
-					endPos.column = col + piecesInARow - 1;
-					return std::pair<BoardPosition, BoardPosition>(startPos, endPos);
-				}
+				const char cell{ state.GetCell(row, col) };
+				if (cell == player)
+					pieces |= BitBoardState::CellMask(row, col);
+				else if (cell != EMPTY)
+					opponent_pieces |= BitBoardState::CellMask(row, col);
 			}
 		}
 
-		return std::pair<BoardPosition, BoardPosition>(INVALID_BOARD_POSITION, INVALID_BOARD_POSITION);
+		return { pieces, opponent_pieces };
 	}
 
-	std::pair<BoardPosition, BoardPosition> GetVerticalChainStartAndEnd(const GameState& state, const char& player, int piecesInARow) const
+	// What one player has on the winning lines.
+	// A chain of n is a line holding n pieces of the player and none of the opponent, so it can still become four in a row
+	struct PlayerLines
 	{
-		BoardPosition startPos{ -1, -1 };
-		BoardPosition endPos{ -1,-1 };
-
-		// Check if connected vertically
-		for (int row = 0; row < state.GetNrRows() - piecesInARow; row++) {
-			for (int col = 0; col < state.GetNrColumns(); col++)
-			{
-				bool connected{ true };
-				startPos.row = row;
-				startPos.column = col;
+		int GetNrChains(int piecesInARow) const
+		{
+			int nr{ 0 };
+			for (const auto& nr_chains : NrChains)
+				nr += nr_chains[piecesInARow];
+			return nr;
+		}
 
-				for (int i = 0; i < piecesInARow; i++)
-				{
-					if (state.GetBoard()[row + i][col] != player) {
-						connected = false;
-						break;
-					}
-				}
+		std::array<int, 5> GetNrChainsPerLength() const
+		{
+			std::array<int, 5> nr_chains{};
+			for (int length{ 0 }; length < 5; ++length)
+				nr_chains[length] = GetNrChains(length);
+			return nr_chains;
+		}
 
-				if (connected)
-				{
-					endPos.row = row + piecesInARow - 1;
-					endPos.column = col;
+		// Number of chains per orientation and length
+		std::array<std::array<int, 5>, WinningLines::NrOrientations> NrChains{};
+		// Empty cells of the chains per orientation and length, a piece on one of them makes the chain one longer
+		std::array<std::array<uint64_t, 5>, WinningLines::NrOrientations> ChainGaps{};
+		// Pieces counted once for every line through them, which adds up EvalTable over the pieces
+		int Positional{ 0 };
+	};
 
-					return std::pair<BoardPosition, BoardPosition>(startPos, endPos);
-				}
+	// One pass over the 69 lines for both players, the first element is the player owning pieces
+	static std::array<PlayerLines, 2> SummarizeLines(uint64_t pieces, uint64_t opponentPieces)
+	{
+		std::array<PlayerLines, 2> players{};
+		for (const WinningLines::Line& line : WinningLines::Lines)
+		{
+			const int orientation{ static_cast<int>(line.Direction) };
+			const int nr_own{ std::popcount(pieces & line.Mask) };
+			const int nr_opponent{ std::popcount(opponentPieces & line.Mask) };
+			players[0].Positional += nr_own;
+			players[1].Positional += nr_opponent;
+
+			// A line with pieces of both players is dead for both
+			if (nr_opponent == 0)
+			{
+				++players[0].NrChains[orientation][nr_own];
+				players[0].ChainGaps[orientation][nr_own] |= line.Mask & ~pieces;
+			}
+			if (nr_own == 0)
+			{
+				++players[1].NrChains[orientation][nr_opponent];
+				players[1].ChainGaps[orientation][nr_opponent] |= line.Mask & ~opponentPieces;
 			}
 		}
 
-		return std::pair<BoardPosition, BoardPosition>(INVALID_BOARD_POSITION, INVALID_BOARD_POSITION);
+		return players;
 	}
 
-	std::pair<BoardPosition, BoardPosition> GetDiagonalChainStartAndEnd(const GameState& state, const char& player, int piecesInARow, bool ascending) const
+	static PlayerLines SummarizeLines(const GameState& state, const char& player)
 	{
-		BoardPosition startPos{ -1, -1 };
-		BoardPosition endPos{ -1,-1 };
+		const auto [pieces, opponent_pieces] { GetPieceMasks(state, player) };
+		return SummarizeLines(pieces, opponent_pieces)[0];
+	}
 
-		if (ascending)
+	// Every column holding at least one of the cells, from left to right
+	static MoveList GetColumns(uint64_t cells)
+	{
+		MoveList columns{};
+		for (int col = 0; col < BitBoardState::NrColumns; ++col)
 		{
-			// Check if connected diagonally (top-right to bottom-left)
-			for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-				for (int col = 0; col < state.GetNrColumns() - piecesInARow + 1; col++)
-				{
-					bool connected{ true };
-					startPos.row = row;
-					startPos.column = col;
-
-					for (int i = 0; i < piecesInARow; i++)
-					{
-						if (state.GetBoard()[row + i][col + i] != player)
-						{
-							connected = false;
-							break;
-						}
-					}
-
-					if (connected)
-					{
-						endPos.row = row + piecesInARow - 1;
-						endPos.column = col + piecesInARow - 1;
-						return std::pair<BoardPosition, BoardPosition>(startPos, endPos);
-					}
-				}
-			}
-		}
-		else
-		{
-			// Check if connected diagonally (top-right to bottom-left)
-			for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-				for (int col = piecesInARow - 1; col < state.GetNrColumns(); col++)
-				{
-					bool connected{ true };
-					startPos.row = row;
-					startPos.column = col;
-
-					for (int i = 0; i < piecesInARow; i++)
-					{
-						if (state.GetBoard()[row + i][col - i] != player)
-						{
-							connected = false;
-							break;
-						}
-					}
-
-					if (connected)
-					{
-						endPos.row = row + piecesInARow - 1;
-						endPos.column = col - piecesInARow + 1;
-						return std::pair<BoardPosition, BoardPosition>(startPos, endPos);
-					}
-				}
-			}
+			if (cells & BitBoardState::ColumnMask(col))
+				columns.push_back(col);
 		}
 
-		return std::pair<BoardPosition, BoardPosition>(INVALID_BOARD_POSITION, INVALID_BOARD_POSITION);
+		return columns;
 	}
 
+	int CountChains(const GameState& state, const char& player, int piecesInARow, std::initializer_list<Orientation> orientations) const
+	{
+		if (piecesInARow < 0 || piecesInARow > 4)
+			return 0;
 
+		const PlayerLines lines{ SummarizeLines(state, player) };
+		int nr{ 0 };
+		for (const Orientation orientation : orientations)
+			nr += lines.NrChains[static_cast<int>(orientation)][piecesInARow];
 
+		return nr;
+	}
 
 	int GetNrHorizontalChains(const GameState& state, const char player, int piecesInARow) const
 	{
-		int nr{ 0 };
-		// Check if connected horizontally
-		for (int row = 0; row < state.GetNrRows(); row++) {
-			for (int col = 0; col < state.GetNrColumns() - piecesInARow + 1; col++)
-			{
-				bool connected{ true };
-				for (int i = 0; i < piecesInARow; i++) {
-					if (state.GetBoard()[row][col + i] != player) {
-						connected = false;
-						break;
-					}
-				}
-
-				if (connected)
-				{
-					++nr;
-					break;
-				}
-			}
-		}
-
-		return nr;
+		return CountChains(state, player, piecesInARow, { Orientation::Horizontal });
 	}
 
 	int GetNrVerticalChains(const GameState& state, const char player, int piecesInARow) const
 	{
-		int nr{ 0 };
-
-		// Check if connected vertically
-		for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-			for (int col = 0; col < state.GetNrColumns(); col++)
-			{
-				bool connected{ true };
-				for (int i = 0; i < piecesInARow; i++)
-				{
-					if (state.GetBoard()[row + i][col] != player)
-					{
-						connected = false;
-						break;
-					}
-				}
-
-				if (connected)
-					++nr;
-			}
-		}
-
-		return nr;
+		return CountChains(state, player, piecesInARow, { Orientation::Vertical });
 	}
 
 	int GetNrDiagonalChains(const GameState& state, const char player, int piecesInARow) const
 	{
-		int nr{ 0 };
-		// Check if connected diagonally (top-right to bottom-left)
-		for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-			for (int col = 0; col < state.GetNrColumns() - piecesInARow + 1; col++)
-			{
-				bool connected{ true };
-
-				for (int i = 0; i < piecesInARow; i++)
-				{
-					if (state.GetBoard()[row + i][col + i] != player)
-					{
-						connected = false;
-						break;
-					}
-				}
-
-				if (connected)
-					++nr;
-			}
-		}
-
-		// Check if connected diagonally (top-right to bottom-left)
-		for (int row = 0; row < state.GetNrRows() - piecesInARow + 1; row++) {
-			for (int col = piecesInARow - 1; col < state.GetNrColumns(); col++)
-			{
-				bool connected{ true };
-
-				for (int i = 0; i < piecesInARow; i++)
-				{
-					if (state.GetBoard()[row + i][col - i] != player)
-					{
-						connected = false;
-						break;
-					}
-				}
-
-				if (connected)
-					++nr;
-			}
-		}
-
-
-		return nr;
+		return CountChains(state, player, piecesInARow, { Orientation::Ascending, Orientation::Descending });
 	}
 
 	int GetNrChains(const GameState& state, const char player, int piecesInARow) const
 	{
-		return
-			GetNrHorizontalChains(state, player, piecesInARow)
-			+ GetNrVerticalChains(state, player, piecesInARow)
-			+ GetNrDiagonalChains(state, player, piecesInARow);
+		return CountChains(state, player, piecesInARow,
+			{ Orientation::Horizontal, Orientation::Vertical, Orientation::Ascending, Orientation::Descending });
 	}
 
-
-
-
-
-	std::vector<int> GetHorizontalCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
+	// Columns where player can drop a piece that turns a chain of piecesInARow - 1 into one of piecesInARow
+	MoveList GetCompletingColumns(const GameState& state, const char& player, int piecesInARow, std::initializer_list<Orientation> orientations) const
 	{
-		std::vector<int> completingColumnsIndices;
+		if (piecesInARow < 1 || piecesInARow > 4)
+			return {};
 
-		// Check if theres a chain of piecesInARow - 1 (almost complete chain) 
-		if (CheckPiecesInAHorizontalRow(state, player, piecesInARow - 1))
-		{
-			// Get the almost completed row
-			std::pair<BoardPosition, BoardPosition> horizontalRow{ GetHorizontalChainStartAndEnd(state, player, piecesInARow - 1) };
-
-			if (horizontalRow.first != INVALID_BOARD_POSITION || horizontalRow.second != INVALID_BOARD_POSITION)
-			{
-				// Check if you can place a piece in the positions next to it
-				if (horizontalRow.first.column - 1 >= 0
-					&& IsEmptyWitFullCellBelow(state, horizontalRow.first.row, horizontalRow.first.column - 1)) //check left side
-				{
-					completingColumnsIndices.push_back(horizontalRow.first.column - 1); //save that move
+		const auto [pieces, opponent_pieces] { GetPieceMasks(state, player) };
+		const PlayerLines lines{ SummarizeLines(pieces, opponent_pieces)[0] };
+		uint64_t completing_cells{ 0 };
+		for (const Orientation orientation : orientations)
+			completing_cells |= lines.ChainGaps[static_cast<int>(orientation)][piecesInARow - 1];
 
-				}
-
-				if (horizontalRow.second.column + 1 < state.GetNrColumns()
-					&& IsEmptyWitFullCellBelow(state, horizontalRow.second.row, horizontalRow.second.column + 1)) //check right side
-				{
-					completingColumnsIndices.push_back(horizontalRow.second.column + 1);
-
-				}
-			}
-		}
-
-		return completingColumnsIndices;
+		return GetColumns(completing_cells & WinningLines::GetPlayableCells(pieces | opponent_pieces));
 	}
 
-	std::vector<int> GetVerticalCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
+	MoveList GetHorizontalCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
 	{
-		std::vector<int> completingColumnsIndices;
-
-		if (CheckPiecesInAVerticalRow(state, player, piecesInARow - 1))
-		{
-			// Get the almost completed row
-			std::pair<BoardPosition, BoardPosition> verticalRow{ GetVerticalChainStartAndEnd(state, player, piecesInARow - 1) };
-
-			if (verticalRow.first != INVALID_BOARD_POSITION || verticalRow.second != INVALID_BOARD_POSITION)
-			{
-				// Check if you can place a piece on top of it
-				if (verticalRow.second.row + 1 < state.GetNrRows()
-					&& IsEmptyWitFullCellBelow(state, verticalRow.second.row + 1, verticalRow.second.column))  //check tower column
-				{
-					completingColumnsIndices.push_back(verticalRow.second.column); //save that move
-				}
-			}
-		}
-
-		return completingColumnsIndices;
+		return GetCompletingColumns(state, player, piecesInARow, { Orientation::Horizontal });
 	}
 
-	std::vector<int> GetDiagonalCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
+	MoveList GetVerticalCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
 	{
-		std::vector<int> completingColumnsIndices;
-
-
-		if (CheckPiecesInADiagonalRow(state, player, piecesInARow - 1, true))
-		{
-			std::pair<BoardPosition, BoardPosition> diagonalRow{ GetDiagonalChainStartAndEnd(state, player, piecesInARow - 1, true) };
-
-			if (diagonalRow.first != INVALID_BOARD_POSITION || diagonalRow.second != INVALID_BOARD_POSITION)
-			{
-				// Check if you can place a piece in the positions next to it
-				if (diagonalRow.first.column - 1 >= 0 && diagonalRow.first.row - 1 >= 0
-					&& IsEmptyWitFullCellBelow(state, diagonalRow.first.row - 1, diagonalRow.first.column - 1))
-				{
-					completingColumnsIndices.push_back(diagonalRow.first.column - 1);
-				}
-
-				if (diagonalRow.second.column + 1 < state.GetNrColumns() && diagonalRow.second.row + 1 < state.GetNrRows()
-					&& IsEmptyWitFullCellBelow(state, diagonalRow.second.row + 1, diagonalRow.second.column + 1))
-				{
-					completingColumnsIndices.push_back(diagonalRow.first.column + 1);
-				}
-			}
-		}
-
-		if (CheckPiecesInADiagonalRow(state, player, piecesInARow - 1, false))
-		{
-			std::pair<BoardPosition, BoardPosition> diagonalRow{ GetDiagonalChainStartAndEnd(state, player, piecesInARow - 1, false) };
-
-			if (diagonalRow.first != INVALID_BOARD_POSITION || diagonalRow.second != INVALID_BOARD_POSITION)
-			{
-				// Check if you can place a piece in the positions next to it
-				if (diagonalRow.first.column + 1 < state.GetNrColumns() && diagonalRow.first.row - 1 >= 0
-					&& IsEmptyWitFullCellBelow(state, diagonalRow.first.row - 1, diagonalRow.first.column + 1))
-				{
-					completingColumnsIndices.push_back(diagonalRow.first.column - 1);
-				}
-
-				if (diagonalRow.second.column - 1 > 0 && diagonalRow.second.row + 1 < state.GetNrRows()
-					&& IsEmptyWitFullCellBelow(state, diagonalRow.second.row + 1, diagonalRow.second.column - 1))
-				{
-					completingColumnsIndices.push_back(diagonalRow.second.column + 1);
-				}
-			}
-		}
-
+		return GetCompletingColumns(state, player, piecesInARow, { Orientation::Vertical });
+	}
 
-		return completingColumnsIndices;
+	MoveList GetDiagonalCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
+	{
+		return GetCompletingColumns(state, player, piecesInARow, { Orientation::Ascending, Orientation::Descending });
 	}
 
 	bool IsDoubleOpenChain(const GameState& state, const Chain& chain) const
@@ -614,128 +406,104 @@ struct C4_Analysis final : public StateAnalysis
 
 
 
-	std::vector<int> GetCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
+	MoveList GetCompletingCellsIndices(const GameState& state, const char& player, int piecesInARow) const
 	{
-		std::vector<int> completingColumnsIndices{};
-
-		const auto horizontalIndices{ GetHorizontalCompletingCellsIndices(state, player, piecesInARow) };
-
-		const auto verticalIndices{ GetVerticalCompletingCellsIndices(state, player, piecesInARow) };
+		// The accumulator already knows the cells completing four in a row
+		const EvaluationAccumulator* pEvaluation{ state.GetEvaluation() };
+		if (pEvaluation && piecesInARow == 4)
+		{
+			const int player_idx{ player == state.GetP1Piece() ? 0 : 1 };
+			const uint64_t mask{ pEvaluation->GetPieces(0) | pEvaluation->GetPieces(1) };
+			return GetColumns(pEvaluation->GetThreats(player_idx) & WinningLines::GetPlayableCells(mask));
+		}
 
-		const auto diagonalIndices{ GetDiagonalCompletingCellsIndices(state, player, piecesInARow) };
+		return GetCompletingColumns(state, player, piecesInARow,
+			{ Orientation::Horizontal, Orientation::Vertical, Orientation::Ascending, Orientation::Descending });
+	}
 
-		completingColumnsIndices.insert(completingColumnsIndices.end(), horizontalIndices.begin(), horizontalIndices.end());
-		completingColumnsIndices.insert(completingColumnsIndices.end(), verticalIndices.begin(), verticalIndices.end());
-		completingColumnsIndices.insert(completingColumnsIndices.end(), diagonalIndices.begin(), diagonalIndices.end());
+	// The longest chain, and the amount of chains of that length, from the number of chains per length
+	static int GetLongestChain(const std::array<int, 5>& nrChains, int& nrOfChains)
+	{
+		for (int length{ 4 }; length > 0; --length)
+		{
+			nrOfChains = nrChains[length];
+			if (nrOfChains > 0)
+				return length;
+		}
 
-		return completingColumnsIndices;
+		nrOfChains = 0;
+		return 0;
 	}
 
 	int GetLongestChain(const GameState& state, const char player, int& nrOfChains) const
 	{
-		// Find the longest chain each player has, and the amount of chains of that length they have
-		int longest_chain{ 0 };
+		return GetLongestChain(SummarizeLines(state, player).GetNrChainsPerLength(), nrOfChains);
+	}
 
-		nrOfChains = 0;
+	// The evaluation of one player's side of the board
+	static int ScoreChains(const std::array<int, 5>& nrChains, int positional)
+	{
+		// https://github.com/prakhar10/Connect4/blob/master/eval_explanation.txt
+		int eval{ nrChains[4] * 10 + nrChains[3] * 5 + nrChains[2] * 2 };
 
-		// Check longest horizontal chain
-		int highest_nr_horizontal_chains{ 0 };
-		for (int i{ 0 }; i < 4; ++i)
-		{
-			int nr_horizontal_chains{ GetNrHorizontalChains(state, player, i) };
+		// https://softwareengineering.stackexchange.com/a/299446
+		int nrof_longestchain{ 0 };
+		eval += GetLongestChain(nrChains, nrof_longestchain) * nrof_longestchain;
 
-			if (nr_horizontal_chains > 0)
-			{
-				longest_chain = i;
-				highest_nr_horizontal_chains = nr_horizontal_chains;
-			}
-			else
-			{
-				nrOfChains += highest_nr_horizontal_chains;
-			}
-		}
+		return eval + positional;
+	}
 
-		// Check if any vertical chain is bigger
-		int highest_nr_vertical_chains{ 0 };
-		for (int i{ longest_chain }; i < 4; ++i)
+	// The opponent owns every piece that isn't forPlayer's, so againstPlayer isn't needed to tell them apart
+	virtual float EvaluatePosition(const GameState& state, const char& forPlayer, [[maybe_unused]] const char& againstPlayer) const override
+	{
+		// Index 0 is forPlayer, 1 againstPlayer
+		std::array<std::array<int, 5>, 2> nr_chains{};
+		std::array<int, 2> positional{};
+		if (const EvaluationAccumulator* pEvaluation{ state.GetEvaluation() })
 		{
-			int nr_vertical_chains{ GetNrVerticalChains(state, player, i) };
-
-			if (nr_vertical_chains > 0)
+			// Kept up to date by PlacePiece, nothing left to count
+			const int for_idx{ forPlayer == state.GetP1Piece() ? 0 : 1 };
+			for (int side{ 0 }; side < 2; ++side)
 			{
-				longest_chain = i;
-				highest_nr_vertical_chains = nr_vertical_chains;
-			}
-			else
-			{
-				// If chain is longer than previous, reset nr of chains, otherside add the amount of chains
-				if (i > longest_chain)
-					nrOfChains = highest_nr_vertical_chains;
-				else
-					nrOfChains += highest_nr_vertical_chains;
+				nr_chains[side] = pEvaluation->GetNrChains(side == 0 ? for_idx : 1 - for_idx);
+				positional[side] = pEvaluation->GetPositional(side == 0 ? for_idx : 1 - for_idx);
 			}
 		}
-
-		// Check if any diagonal chain is bigger
-		int highest_nr_diagonal_chains{ 0 };
-		for (int i{ longest_chain }; i < 4; ++i)
+		else
 		{
-			int nr_diagonal_chains{ GetNrDiagonalChains(state, player, i) };
-
-			if (nr_diagonal_chains > 0)
-			{
-				longest_chain = i;
-				highest_nr_diagonal_chains = nr_diagonal_chains;
-			}
-			else
+			const auto [for_pieces, against_pieces] { GetPieceMasks(state, forPlayer) };
+			const std::array<PlayerLines, 2> lines{ SummarizeLines(for_pieces, against_pieces) };
+			for (int side{ 0 }; side < 2; ++side)
 			{
-				if (i > longest_chain)
-					nrOfChains = highest_nr_diagonal_chains;
-				else
-					nrOfChains += highest_nr_diagonal_chains;
+				nr_chains[side] = lines[side].GetNrChainsPerLength();
+				positional[side] = lines[side].Positional;
 			}
 		}
 
-		return longest_chain;
-	}
-
-
-
-	virtual float StateAnalysis::EvaluatePosition(const GameState& state, const char& forPlayer, const char& againstPlayer) const override
-	{
-		if (CheckWin(state, forPlayer))
+		if (nr_chains[0][4] > 0)
 			return FLT_MAX;
 
-		if (CheckWin(state, againstPlayer))
+		if (nr_chains[1][4] > 0)
 			return FLT_MIN;
 
 		if (CheckDraw(state))
 			return 0;
 
+		return static_cast<float>(ScoreChains(nr_chains[0], positional[0]) - ScoreChains(nr_chains[1], positional[1]));
+	}
+};
 
-		float eval{ 0 };
-		// https://github.com/prakhar10/Connect4/blob/master/eval_explanation.txt
-		eval += GetNrChains(state, forPlayer, 4) * 10 + GetNrChains(state, forPlayer, 3) * 5 + GetNrChains(state, forPlayer, 2) * 2;
-		eval -= GetNrChains(state, againstPlayer, 4) * 10 + GetNrChains(state, againstPlayer, 3) * 5 + GetNrChains(state, againstPlayer, 2) * 2;
-
-		// https://softwareengineering.stackexchange.com/a/299446
-		int forplayer_nrof_longestchain{ 0 };
-		int againstplayer_nrof_longestchain{ 0 };
-		eval += GetLongestChain(state, forPlayer, forplayer_nrof_longestchain) * forplayer_nrof_longestchain;
-		eval -= GetLongestChain(state, againstPlayer, againstplayer_nrof_longestchain) * againstplayer_nrof_longestchain;
-
-
-
-		for (int row = 0; row < state.GetNrRows(); row++) {
-			for (int col = 0; col < state.GetNrColumns(); col++)
+// The positional part of EvaluatePosition comes from the line pass, which only adds up EvalTable
+// as long as every entry is the number of lines through its cell
+static_assert([]
+	{
+		for (int row{ 0 }; row < WinningLines::NrRows; ++row)
+		{
+			for (int column{ 0 }; column < WinningLines::NrColumns; ++column)
 			{
-				if (state.GetBoard()[row][col] == forPlayer)
-					eval += EvalTable[row][col];
-				else if (state.GetBoard()[row][col] == againstPlayer)
-					eval -= EvalTable[row][col];
+				if (C4_Analysis::EvalTable[row][column] != WinningLines::GetLinesThrough(row, column).Size)
+					return false;
 			}
 		}
-
-		return eval;
-	}
-};
\ No newline at end of file
+		return true;
+	}(), "EvalTable has to hold the number of winning lines through every cell");
@@ -0,0 +1,138 @@
+#include "pch.h"
+#include "EndgameSolver.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include "WinningLines.h"
+
+namespace
+{
+	// Stored next to the value, tells what the value says about the position
+	enum class Bound : uint64_t
+	{
+		Exact = 1,
+		Lower = 2,
+		Upper = 3
+	};
+
+	// Center columns first, they take part in the most lines
+	constexpr std::array<int, BitBoardState::NrColumns> ColumnOrder{ 3, 2, 4, 1, 5, 0, 6 };
+
+	// Empty cells that would complete four in a row of pieces, whether they can be played yet or not.
+	// For every direction, the cell has to line up with three pieces: three on one side, or two on one side and one on the other
+	uint64_t GetWinningCells(uint64_t pieces, uint64_t mask)
+	{
+		// Vertical, only from below
+		uint64_t cells{ (pieces << 1) & (pieces << 2) & (pieces << 3) };
+
+		constexpr int directions[]{
+			BitBoardState::ColumnHeight,		// horizontal
+			BitBoardState::ColumnHeight - 1,	// descending diagonal
+			BitBoardState::ColumnHeight + 1 };	// ascending diagonal
+
+		for (const int direction : directions)
+		{
+			uint64_t pair{ (pieces << direction) & (pieces << (2 * direction)) };
+			cells |= pair & (pieces << (3 * direction));
+			cells |= pair & (pieces >> direction);
+			pair = (pieces >> direction) & (pieces >> (2 * direction));
+			cells |= pair & (pieces << direction);
+			cells |= pair & (pieces >> (3 * direction));
+		}
+
+		return cells & (WinningLines::BoardCells ^ mask);
+	}
+}
+
+int EndgameSolver::Solve(const BitBoardState& state)
+{
+	if (m_Table.empty())
+		m_Table.resize(size_t{ 1 } << TableSizeLog2);
+
+	// The window covers every value, so the result is exact
+	return Negamax(state.GetPieces(state.GetCurrentPlayer()), state.GetMask(), state.GetNrPieces(), Loss, Win);
+}
+
+int EndgameSolver::Negamax(uint64_t pieces, uint64_t mask, int nrPieces, int alpha, int beta)
+{
+	++m_NrNodes;
+
+	if (nrPieces == BitBoardState::NrRows * BitBoardState::NrColumns)
+		return Draw;
+
+	uint64_t playable{ WinningLines::GetPlayableCells(mask) };
+	if (playable & GetWinningCells(pieces, mask))
+		return Win;
+
+	// The opponent wins next move unless we block, two threats can't both be blocked
+	const uint64_t opponent_pieces{ pieces ^ mask };
+	const uint64_t opponent_wins{ GetWinningCells(opponent_pieces, mask) };
+	const uint64_t forced{ playable & opponent_wins };
+	if (forced)
+	{
+		if (forced & (forced - 1))
+			return Loss;
+		playable = forced;
+	}
+
+	// Playing right below a winning cell of the opponent lets them play it
+	playable &= ~(opponent_wins >> 1);
+	if (playable == 0)
+		return Loss;
+
+	const uint64_t key{ pieces + mask };
+	uint64_t& entry{ m_Table[key & ((uint64_t{ 1 } << TableSizeLog2) - 1)] };
+	if (entry != 0 && (entry >> 4) == key)
+	{
+		const int value{ static_cast<int>(entry & 3) - 1 };
+		const Bound bound{ static_cast<Bound>((entry >> 2) & 3) };
+		if (bound == Bound::Exact)
+			return value;
+		if (bound == Bound::Lower)
+			alpha = std::max(alpha, value);
+		else
+			beta = std::min(beta, value);
+		if (alpha >= beta)
+			return value;
+	}
+
+	// Moves that leave us the most winning cells first, the center breaks ties
+	std::array<uint64_t, BitBoardState::NrColumns> moves{};
+	std::array<int, BitBoardState::NrColumns> move_scores{};
+	int nr_moves{ 0 };
+	for (const int column : ColumnOrder)
+	{
+		const uint64_t move{ playable & BitBoardState::ColumnMask(column) };
+		if (move == 0)
+			continue;
+
+		const int score{ std::popcount(GetWinningCells(pieces | move, mask | move)) };
+		int idx{ nr_moves++ };
+		for (; idx > 0 && move_scores[idx - 1] < score; --idx)
+		{
+			moves[idx] = moves[idx - 1];
+			move_scores[idx] = move_scores[idx - 1];
+		}
+		moves[idx] = move;
+		move_scores[idx] = score;
+	}
+
+	const int original_alpha{ alpha };
+	int best{ Loss };
+	for (int i{ 0 }; i < nr_moves; ++i)
+	{
+		// The opponent moves next, their pieces become the pieces to move
+		const int value{ -Negamax(opponent_pieces, mask | moves[i], nrPieces + 1, -beta, -alpha) };
+		if (value > best)
+		{
+			best = value;
+			alpha = std::max(alpha, value);
+			if (alpha >= beta)
+				break;
+		}
+	}
+
+	const Bound bound{ best <= original_alpha ? Bound::Upper : best >= beta ? Bound::Lower : Bound::Exact };
+	entry = (key << 4) | (static_cast<uint64_t>(bound) << 2) | static_cast<uint64_t>(best + 1);
+	return best;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "BitBoardState.h"
+
+// Exact solver for Connect 4 positions close to the end of the game: negamax with alpha-beta pruning
+// on the win/draw/loss value, a transposition table, and moves ordered by the threats they create.
+// Like BatchRollout it plays by the standard Connect 4 rules itself.
+// Not thread safe, every search thread owns one.
+class EndgameSolver final
+{
+public:
+	// Values of a position for the player to move
+	static constexpr int Loss{ -1 };
+	static constexpr int Draw{ 0 };
+	static constexpr int Win{ 1 };
+
+	// The game in state must not be over yet
+	int Solve(const BitBoardState& state);
+
+	// Positions searched since the solver was made
+	uint64_t GetNrNodes() const { return m_NrNodes; };
+private:
+	// Entries of the transposition table, 8 bytes each
+	static constexpr int TableSizeLog2{ 18 };
+
+	// pieces are the pieces of the player to move, mask those of both players
+	int Negamax(uint64_t pieces, uint64_t mask, int nrPieces, int alpha, int beta);
+
+	// A position is identified by pieces + mask, which is unique and fits in 49 bits, so the table keeps
+	// the whole key and never needs clearing: every entry stays true for the position it belongs to.
+	// The low 4 bits hold the bound type and the value, an empty entry is 0
+	std::vector<uint64_t> m_Table{};
+	uint64_t m_NrNodes{ 0 };
+};
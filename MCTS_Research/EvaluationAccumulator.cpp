@@ -0,0 +1,47 @@
+#include "pch.h"
+#include "EvaluationAccumulator.h"
+
+void EvaluationAccumulator::Reset()
+{
+	m_LinePieces = {};
+	m_NrChains = {};
+	m_Positional = {};
+	m_Threats = {};
+	m_Pieces = {};
+
+	// Every line starts out as an empty chain of both players
+	m_NrChains[0][0] = WinningLines::NrLines;
+	m_NrChains[1][0] = WinningLines::NrLines;
+}
+
+void EvaluationAccumulator::PlacePiece(int playerIdx, int row, int column)
+{
+	const int opponent_idx{ 1 - playerIdx };
+	const uint64_t cell{ BitBoardState::CellMask(row, column) };
+	m_Pieces[playerIdx] |= cell;
+
+	for (const int line : WinningLines::GetLinesThrough(row, column))
+	{
+		const int nr_own{ m_LinePieces[playerIdx][line]++ };
+		const int nr_opponent{ m_LinePieces[opponent_idx][line] };
+		// Every line through the cell adds one, which is what EvalTable holds for it
+		++m_Positional[playerIdx];
+
+		// A chain of the player grows by one, a chain of the opponent is blocked
+		if (nr_opponent == 0)
+		{
+			--m_NrChains[playerIdx][nr_own];
+			++m_NrChains[playerIdx][nr_own + 1];
+
+			// The one cell of the line that is still empty completes it
+			if (nr_own + 1 == 3)
+				m_Threats[playerIdx] |= WinningLines::Lines[line].Mask & ~m_Pieces[playerIdx];
+		}
+		if (nr_own == 0)
+			--m_NrChains[opponent_idx][nr_opponent];
+	}
+
+	// Threats are only ever removed by filling their cell, a line blocked by this piece had its empty cell here
+	m_Threats[0] &= ~cell;
+	m_Threats[1] &= ~cell;
+}
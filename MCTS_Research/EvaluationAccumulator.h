@@ -0,0 +1,34 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include "WinningLines.h"
+
+// What both players have on the winning lines, kept up to date one piece at a time.
+// Placing a piece only touches the lines through its cell, after that every count is a lookup.
+// A chain of n is a line holding n pieces of the player and none of the opponent, as in C4_Analysis.
+// playerIdx is 0 for the first player, 1 for the second
+class EvaluationAccumulator final
+{
+public:
+	EvaluationAccumulator() { Reset(); };
+
+	void Reset();
+	void PlacePiece(int playerIdx, int row, int column);
+
+	// Number of chains per length, 0 to 4 pieces
+	const std::array<int, 5>& GetNrChains(int playerIdx) const { return m_NrChains[playerIdx]; };
+	int GetNrOpenThrees(int playerIdx) const { return m_NrChains[playerIdx][3]; };
+	bool HasFourInARow(int playerIdx) const { return m_NrChains[playerIdx][4] > 0; };
+	// Sum of EvalTable over the pieces of the player
+	int GetPositional(int playerIdx) const { return m_Positional[playerIdx]; };
+	// Empty cells that would give the player four in a row, whether a piece can be dropped on them yet or not
+	uint64_t GetThreats(int playerIdx) const { return m_Threats[playerIdx]; };
+	// Pieces in the bitboard layout of BitBoardState
+	uint64_t GetPieces(int playerIdx) const { return m_Pieces[playerIdx]; };
+private:
+	std::array<std::array<uint8_t, WinningLines::NrLines>, 2> m_LinePieces{};
+	std::array<std::array<int, 5>, 2> m_NrChains{};
+	std::array<int, 2> m_Positional{};
+	std::array<uint64_t, 2> m_Threats{};
+	std::array<uint64_t, 2> m_Pieces{};
+};
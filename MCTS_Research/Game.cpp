@@ -65,20 +65,30 @@ void Game::Update(float elapsedSec)
 			return;
 		}
 
-		if (m_pStateAnalysis->CheckWin(*m_pBoard, current_player->GetInitial()))
+		if (m_pStateAnalysis->CheckWinAfterMove(*m_pBoard, move))
 		{
 			std::cout << current_player->GetName() << " wins!\n";
 			m_GameFinished = true;
+			m_pPlayer1->StopPondering();
+			m_pPlayer2->StopPondering();
 			return;
 		}
 
 		if (m_pStateAnalysis->CheckDraw(*m_pBoard))
 		{
 			std::cout << "Draw!\n";
+			m_pPlayer1->StopPondering();
+			m_pPlayer2->StopPondering();
 			return;
 		}
 
 		m_FirstPlayerTurn = !m_FirstPlayerTurn;
+
+		// Use the opponent's time to search ahead. Only against a human, an AI opponent
+		// runs its own search on every core and would lose half of its thinking time to ours
+		const Player* opponent{ m_FirstPlayerTurn ? m_pPlayer1 : m_pPlayer2 };
+		if (opponent->IsHuman())
+			current_player->Ponder(*m_pBoard);
 	}
 }
 
@@ -1,6 +1,6 @@
-#pragma once
 #include "pch.h"
 #include "GameState.h"
+#include "Zobrist.h"
 #include <iostream>
 
 GameState::GameState()
@@ -20,6 +20,8 @@ GameState::GameState(const GameState& other)
     , m_LastMove{ other.m_LastMove }
     , m_P1Turn{ other.m_P1Turn }
     , m_NrPieces{other.m_NrPieces}
+    , m_Hash{ other.m_Hash }
+    , m_Evaluation{ other.m_Evaluation }
     , m_Player1{other.m_Player1}
     , m_Player2{other.m_Player2}
 {
@@ -28,6 +30,8 @@ GameState::GameState(const GameState& other)
 GameState& GameState::operator=(const GameState& other)
 {
     m_NrPieces = other.m_NrPieces;
+    m_Hash = other.m_Hash;
+    m_Evaluation = other.m_Evaluation;
     m_LastMove = other.m_LastMove;
     m_Board = other.m_Board;
     m_P1Turn = other.m_P1Turn;
@@ -49,10 +53,28 @@ void GameState::Reset()
 {
     m_P1Turn = true;
     m_NrPieces = 0;
+    m_Hash = 0;
     m_LastMove = INVALID_INDEX;
+    if (m_Evaluation)
+        m_Evaluation->Reset();
     Initialize();
 }
 
+void GameState::EnableEvaluation()
+{
+    m_Evaluation.emplace();
+    for (int row{ 0 }; row < GetNrRows(); ++row)
+    {
+        for (int col{ 0 }; col < GetNrColumns(); ++col)
+        {
+            if (m_Board[row][col] == m_Player1)
+                m_Evaluation->PlacePiece(0, row, col);
+            else if (m_Board[row][col] == m_Player2)
+                m_Evaluation->PlacePiece(1, row, col);
+        }
+    }
+}
+
 bool GameState::PlacePiece(const int& column, const char& player)
 {
     // Catch player on wrong turn
@@ -78,6 +100,9 @@ bool GameState::PlacePiece(const int& column, const char& player)
     {
         // Place the piece in the cell.
         m_Board[row + 1][column] = player;
+        m_Hash ^= Zobrist::GetKey(m_P1Turn ? 0 : 1, row + 1, column);
+        if (m_Evaluation)
+            m_Evaluation->PlacePiece(m_P1Turn ? 0 : 1, row + 1, column);
         m_LastMove = column;
         ++m_NrPieces;
         m_P1Turn = !m_P1Turn;
@@ -1,6 +1,9 @@
 #pragma once
 #include "StateAnalysis.h"
+#include "EvaluationAccumulator.h"
 #include <array>
+#include <cstdint>
+#include <optional>
 class GameState
 {
 public:
@@ -16,25 +19,36 @@ public:
 
 	bool PlacePiece(const int& column, const char& player);
 
+	// Starts keeping an EvaluationAccumulator of the pieces on the board, PlacePiece updates it from then on.
+	// Off by default, it makes placing a piece and copying the state more expensive
+	void EnableEvaluation();
+	// nullptr unless EnableEvaluation was called
+	const EvaluationAccumulator* GetEvaluation() const { return m_Evaluation ? &*m_Evaluation : nullptr; };
+
 	//Getters
-	std::array<std::array<char, 7>, 6> GetBoard() const { return m_Board; };
+	const std::array<std::array<char, 7>, 6>& GetBoard() const { return m_Board; };
+	char GetCell(int row, int column) const { return m_Board[row][column]; };
 	int GetLastMove() const { return m_LastMove; };
+	// Zobrist hash of the pieces on the board, kept up to date by PlacePiece
+	uint64_t GetHash() const { return m_Hash; };
 	int GetNrRows() const { return static_cast<int>(m_Board.size()); };
 	int GetNrColumns() const { return static_cast<int>(m_Board[0].size()); };
 	int GetNrPieces() const { return m_NrPieces; };
-	char GetP1Piece() { return m_Player1; };
-	char GetP2Piece() { return m_Player2; };
+	char GetP1Piece() const { return m_Player1; };
+	char GetP2Piece() const { return m_Player2; };
 	bool IsPlayer1Turn() const { return m_P1Turn; };
-	bool IsPlayerTurn(const char& player) { return (m_P1Turn && player == m_Player1); };
+	bool IsPlayerTurn(const char& player) const { return player == GetCurrentPlayer(); };
 	char GetCurrentPlayer() const { if (m_P1Turn) return m_Player1; else return m_Player2; };
-	char GetWaitingPlayer() const { if (!m_P1Turn) return m_Player2; else return m_Player1; };
-	char GetOpponentPiece(const char& myPiece) { if (myPiece == m_Player1) return m_Player1; else return m_Player2; };
+	char GetWaitingPlayer() const { if (m_P1Turn) return m_Player2; else return m_Player1; };
+	char GetOpponentPiece(const char& myPiece) const { if (myPiece == m_Player1) return m_Player2; else return m_Player1; };
 protected:
 	std::array<std::array<char, 7>, 6> m_Board{};
 	int m_LastMove{ INVALID_INDEX };
 	bool m_P1Turn{ true };
 
 	int m_NrPieces{ 0 };
+	uint64_t m_Hash{ 0 };
+	std::optional<EvaluationAccumulator> m_Evaluation{};
 	char m_Player1;
 	char m_Player2;
 };
@@ -1,164 +1,892 @@
-#pragma once
 #include "pch.h"
 #include "MonteCarloTreeSearch.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
 #include <random>
-#include <iostream>			
-#include "Player.h"
+#include <thread>
+#include <type_traits>
+#include "BatchRollout.h"
 #include "C4Analysis.h"
+#include "Profiler.h"
 
-MonteCarloTreeSearch::MonteCarloTreeSearch(Player* player)
-	: m_RootNode{ new MCTSNode() }
+template<typename Rules>
+MonteCarloTreeSearch<Rules>::MonteCarloTreeSearch(Player* player, const MCTSSettings& settings, const Rules& rules)
+	: m_Settings{ settings }
 	, m_pPlayer{ player }
-	, m_pStateAnalysis{ new C4_Analysis() }
+	, m_Rules{ rules }
 {
+	m_Settings.NrThreads = std::max(1, m_Settings.NrThreads);
+	m_Settings.NrRollouts = std::max(1, m_Settings.NrRollouts);
+
+	// Virtual loss only matters when other threads select in the same tree
+	if (m_Settings.Parallelism != ParallelMode::Tree || m_Settings.NrThreads == 1)
+		m_Settings.VirtualLoss = 0;
+
+	const int nr_trees{ m_Settings.Parallelism == ParallelMode::Root ? m_Settings.NrThreads : 1 };
+	for (int i{ 0 }; i < nr_trees; ++i)
+		m_Trees.push_back(std::make_unique<SearchTree>());
+
+	if (m_Settings.Seed == 0)
+		m_Settings.Seed = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+
+	// Every worker gets its own random stream, derived from the seed and its index
+	m_Workers.resize(m_Settings.NrThreads);
+	for (size_t i{ 0 }; i < m_Workers.size(); ++i)
+	{
+		m_Workers[i].Path.reserve(BitBoardState::NrRows * BitBoardState::NrColumns + 1);
+		m_Workers[i].EdgePath.reserve(BitBoardState::NrRows * BitBoardState::NrColumns);
+		m_Workers[i].Random.Seed(m_Settings.Seed + i);
+	}
+
+	if (m_Settings.Parallelism == ParallelMode::Leaf && m_Settings.NrThreads > 1)
+		m_pRolloutPool = std::make_unique<WorkerPool>(m_Settings.NrThreads);
 }
 
-MonteCarloTreeSearch::~MonteCarloTreeSearch()
+template<typename Rules>
+MonteCarloTreeSearch<Rules>::~MonteCarloTreeSearch()
 {
-	if (m_RootNode)
+	CancelSearch();
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::FindNextMove(const GameState& pBoard)
+{
+	return FindNextMove(pBoard, m_Settings.Limits);
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::FindNextMove(const GameState& pBoard, const SearchLimits& limits)
+{
+	// Without any limit the search would never end
+	assert(limits.NrIterations > 0 || limits.NrNodes > 0 || limits.Time.count() > 0);
+
+	// What was searched while the opponent was thinking is kept by SetRoot
+	CancelSearch();
+
+	// The search runs on the bitboard representation of the board
+	const BitBoardState root_state{ pBoard };
+	PrepareSearch(root_state, limits, m_Settings.CollectReport);
+	RunSearch();
+
+	return GetBestMove(root_state);
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::FindNextMove(const GameState& pBoard, const SearchLimits& limits, SearchReport& report)
+{
+	assert(limits.NrIterations > 0 || limits.NrNodes > 0 || limits.Time.count() > 0);
+
+	CancelSearch();
+	PrepareSearch(BitBoardState{ pBoard }, limits, true);
+	RunSearch();
+
+	report = m_Report;
+	return report.BestMove;
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::StartSearch(const GameState& pBoard)
+{
+	StartSearch(pBoard, m_Settings.Limits);
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::StartSearch(const GameState& pBoard, const SearchLimits& limits)
+{
+	// Without any limit the search would never end
+	assert(limits.NrIterations > 0 || limits.NrNodes > 0 || limits.Time.count() > 0);
+
+	StartSearchThread(pBoard, limits);
+}
+
+template<typename Rules>
+SearchProgress MonteCarloTreeSearch<Rules>::GetProgress() const
+{
+	// The trees aren't touched outside of PrepareSearch, so their statistics can be read while searching
+	SearchProgress progress{};
+	progress.NrIterations = m_NrIterations.load(std::memory_order_relaxed);
+	progress.NrRollouts = m_NrRollouts.load(std::memory_order_relaxed);
+	for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+		progress.NrNodes += tree->Nodes.GetNrAllocated();
+	progress.Time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_SearchStart);
+	const SearchTree& tree{ *m_Trees[0] };
+	if (tree.RootNode != INVALID_NODE && !tree.Nodes[tree.RootNode].IsLeaf())
+		progress.BestMove = GetBestMove(tree.RootState);
+	return progress;
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::CancelSearch()
+{
+	if (!m_SearchThread.joinable())
+		return;
+
+	m_StopSearch.store(true, std::memory_order_relaxed);
+	m_SearchThread.join();
+	m_IsPondering = false;
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::GetSearchResult()
+{
+	if (m_SearchThread.joinable())
+		m_SearchThread.join();
+
+	return GetBestMove(m_Trees[0]->RootState);
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::StartPondering(const GameState& pBoard)
+{
+	StartSearchThread(pBoard, m_Settings.PonderLimits);
+	m_IsPondering = true;
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::StopPondering()
+{
+	if (m_IsPondering)
+		CancelSearch();
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::StartSearchThread(const GameState& pBoard, const SearchLimits& limits)
+{
+	CancelSearch();
+
+	PrepareSearch(BitBoardState{ pBoard }, limits, m_Settings.CollectReport);
+	m_SearchDone.store(false, std::memory_order_relaxed);
+	m_SearchThread = std::thread{ [this]()
+		{
+			RunSearch();
+			m_SearchDone.store(true, std::memory_order_release);
+		} };
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::PrepareSearch(const BitBoardState& rootState, const SearchLimits& limits, bool collectReport)
+{
+	// Reset on the calling thread, so a stop requested right after starting can't be missed
+	m_Limits = limits;
+	m_SearchStart = std::chrono::steady_clock::now();
+	m_Deadline = m_SearchStart + limits.Time;
+	m_StopSearch.store(false, std::memory_order_relaxed);
+	m_NrIterations.store(0, std::memory_order_relaxed);
+	m_NrRollouts.store(0, std::memory_order_relaxed);
+	for (SearchWorker& worker : m_Workers)
+		worker.NrRollouts = 0;
+	m_NrIterationsLeft.store(limits.NrIterations, std::memory_order_relaxed);
+
+	for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+		SetRoot(*tree, rootState);
+
+	// Make room for the positions this search may add, the transposition table can't grow while the threads share it
+	if (m_Settings.UseTranspositions)
+	{
+		size_t nr_new_positions{ MaxReservedPositions };
+		if (limits.NrIterations > 0)
+			nr_new_positions = std::min(nr_new_positions, static_cast<size_t>(limits.NrIterations) * BitBoardState::NrColumns);
+		if (limits.NrNodes > 0)
+			nr_new_positions = std::min(nr_new_positions, static_cast<size_t>(limits.NrNodes));
+
+		for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+			tree->Table.Reserve(tree->Table.GetNrEntries() + nr_new_positions);
+	}
+
+	m_CollectReport = collectReport;
+	if (m_CollectReport)
 	{
-		for (auto& child : m_RootNode->Children)
+		m_NrNodesAtStart = 0;
+		for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+			m_NrNodesAtStart += tree->Nodes.GetNrAllocated();
+
+		for (SearchWorker& worker : m_Workers)
 		{
-			delete child;
-			child = nullptr;
+			worker.PhaseTimes = {};
+			worker.DepthSum = 0;
+			worker.MaxDepth = 0;
+			worker.NrSolvedLeaves = 0;
+		}
+	}
+}
 
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::RunSearch()
+{
+	// Every extra worker gets its own thread, the first one searches on this thread.
+	// In root parallel mode every worker has its own tree, otherwise they all share the first one.
+	// In leaf parallel mode the other workers only help out with the rollouts
+	// A previous search may already have proven the root, e.g. while pondering
+	const bool is_proven{ std::any_of(m_Trees.begin(), m_Trees.end(), [this](const std::unique_ptr<SearchTree>& tree)
+		{
+			return IsRootProven(*tree);
+		}) };
+	if (is_proven)
+	{
+		if (m_CollectReport)
+			MakeReport();
+		return;
+	}
+
+	auto get_tree = [this](size_t worker) -> SearchTree& { return *m_Trees[worker < m_Trees.size() ? worker : 0]; };
+	const size_t nr_searching_workers{ m_Settings.Parallelism == ParallelMode::Leaf ? 1 : m_Workers.size() };
+
+	std::vector<std::thread> threads{};
+	threads.reserve(nr_searching_workers - 1);
+	for (size_t i{ 1 }; i < nr_searching_workers; ++i)
+		threads.emplace_back([this, i, &get_tree]() { Search(get_tree(i), m_Workers[i]); });
+
+	Search(get_tree(0), m_Workers[0]);
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	if (m_CollectReport)
+		MakeReport();
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::GetBestMove(const BitBoardState& rootState) const
+{
+	// Merge the root statistics of all trees and find the move with most visits.
+	// A proof found in any tree holds for all of them
+	std::array<uint64_t, BitBoardState::NrColumns> move_visits{};
+	std::array<Proof, BitBoardState::NrColumns> move_proofs{};
+	for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+	{
+		// Nothing was searched yet
+		if (tree->RootNode == INVALID_NODE)
+			continue;
+
+		const MCTSNode& root{ tree->Nodes[tree->RootNode] };
+		for (NodeIndex edge{ root.FirstEdge }; edge < root.FirstEdge + root.GetNrChildren(); ++edge)
+		{
+			const MCTSEdge& root_edge{ tree->Edges[edge] };
+			const MCTSNode& child{ tree->Nodes[root_edge.Child] };
+			move_visits[root_edge.Move] += child.VisitCount.load(std::memory_order_relaxed);
+			if (child.IsProven())
+				move_proofs[root_edge.Move] = child.GetProof();
+		}
+	}
+
+	// A proven win is played whatever the visits say
+	for (int move{ 0 }; move < BitBoardState::NrColumns; ++move)
+	{
+		if (rootState.CanPlay(move) && move_proofs[move] == Proof::Win)
+			return move;
+	}
+
+	// A proven loss only when every move loses
+	int best_move{ INVALID_INDEX };
+	for (const bool skip_losses : { true, false })
+	{
+		for (int move{ 0 }; move < BitBoardState::NrColumns; ++move)
+		{
+			if (!rootState.CanPlay(move) || (skip_losses && move_proofs[move] == Proof::Loss))
+				continue;
+
+			if (best_move == INVALID_INDEX || move_visits[move] > move_visits[best_move])
+				best_move = move;
 		}
 
-		m_RootNode->Children.clear();
-		delete m_RootNode;
-		m_RootNode = nullptr;
+		if (best_move != INVALID_INDEX)
+			break;
+	}
+
+	return best_move;
+}
+
+template<typename Rules>
+bool MonteCarloTreeSearch<Rules>::IsRootProven(const SearchTree& tree) const
+{
+	if (tree.RootNode == INVALID_NODE)
+		return false;
+
+	const MCTSNode& root{ tree.Nodes[tree.RootNode] };
+	return root.IsProven() && !root.IsLeaf();
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::MakeReport()
+{
+	SearchReport report{};
+	report.NrIterations = m_NrIterations.load(std::memory_order_relaxed);
+	report.NrRollouts = m_NrRollouts.load(std::memory_order_relaxed);
+	report.Time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_SearchStart);
+	for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+		report.NrNodes += tree->Nodes.GetNrAllocated();
+	report.NrNewNodes = report.NrNodes - m_NrNodesAtStart;
+
+	uint64_t depth_sum{ 0 };
+	for (const SearchWorker& worker : m_Workers)
+	{
+		for (int phase{ 0 }; phase < NrSearchPhases; ++phase)
+			report.PhaseTimes[phase] += worker.PhaseTimes[phase];
+		depth_sum += worker.DepthSum;
+		report.MaxDepth = std::max(report.MaxDepth, worker.MaxDepth);
+		report.NrSolvedLeaves += worker.NrSolvedLeaves;
+	}
+	if (report.NrIterations > 0)
+		report.AverageDepth = static_cast<float>(depth_sum) / static_cast<float>(report.NrIterations);
+
+	// Merge the root statistics of all trees, like GetBestMove does
+	std::array<SearchReport::RootChild, BitBoardState::NrColumns> root_children{};
+	for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+	{
+		const MCTSNode& root{ tree->Nodes[tree->RootNode] };
+		for (NodeIndex edge{ root.FirstEdge }; edge < root.FirstEdge + root.GetNrChildren(); ++edge)
+		{
+			const MCTSEdge& root_edge{ tree->Edges[edge] };
+			const MCTSNode& child{ tree->Nodes[root_edge.Child] };
+			root_children[root_edge.Move].Move = root_edge.Move;
+			root_children[root_edge.Move].NrVisits += child.VisitCount.load(std::memory_order_relaxed);
+			root_children[root_edge.Move].NrWins += child.WinCount.load(std::memory_order_relaxed);
+		}
+	}
+	for (const SearchReport::RootChild& child : root_children)
+	{
+		if (child.Move != INVALID_INDEX)
+			report.RootChildren.push_back(child);
 	}
 
+	report.BestMove = GetBestMove(m_Trees[0]->RootState);
+	m_Report = std::move(report);
 }
 
-int MonteCarloTreeSearch::FindNextMove(const GameState& pBoard)
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::Search(SearchTree& tree, SearchWorker& worker)
 {
-	m_RootNode = new MCTSNode(pBoard);
-	MCTSNode* promising_node{ };
-	for (int i = 0; i < m_NrIterations; i++)
+	// Phases are only timed for a report, the clock is read between every two of them
+	using Clock = std::chrono::steady_clock;
+	const bool collect_report{ m_CollectReport };
+	Clock::time_point phase_start{};
+	auto end_phase = [&worker, &phase_start, collect_report](SearchPhase phase)
+		{
+			if (!collect_report)
+				return;
+
+			const Clock::time_point now{ Clock::now() };
+			worker.PhaseTimes[static_cast<int>(phase)] += now - phase_start;
+			phase_start = now;
+		};
+
+	NodeIndex promising_node{ };
+	int i{ 0 };
+	int nr_counted_iterations{ 0 };
+	// Threads sharing a tree draw their iterations from one budget, otherwise every thread has all of them
+	const bool shared_budget{ m_Settings.Parallelism == ParallelMode::Tree };
+	int iteration_budget{ shared_budget ? 0 : m_Limits.NrIterations };
+	for (;; i++)
 	{
-		// Select a node with highest Upper Confidence Boundary
-		promising_node = SelectNode(m_RootNode);
+		if (m_Limits.NrIterations > 0 && i >= iteration_budget)
+		{
+			const int nr_claimed{ shared_budget ? ClaimIterations() : 0 };
+			if (nr_claimed == 0)
+				break;
+			iteration_budget += nr_claimed;
+		}
+
+		// Stop with what we have when this or another thread ran out of time or memory, or the search was cancelled
+		if (m_StopSearch.load(std::memory_order_relaxed))
+			break;
+
+		// Once the root is proven more iterations can't change the move, the other threads can stop as well
+		if (IsRootProven(tree))
+		{
+			m_StopSearch.store(true, std::memory_order_relaxed);
+			break;
+		}
+
+		if (i % LimitCheckInterval == LimitCheckInterval - 1)
+		{
+			m_NrIterations.fetch_add(i - nr_counted_iterations, std::memory_order_relaxed);
+			nr_counted_iterations = i;
+			m_NrRollouts.fetch_add(std::exchange(worker.NrRollouts, 0), std::memory_order_relaxed);
+
+			if (IsBudgetSpent())
+			{
+				m_StopSearch.store(true, std::memory_order_relaxed);
+				break;
+			}
+		}
+
+		if (collect_report)
+			phase_start = Clock::now();
 
-		// If state of node isn't complete, make a new child node for all possible moves
-		if (m_pStateAnalysis->InProgress(promising_node->State))
-			Expand(promising_node);
+		// Select a node with highest Upper Confidence Boundary, rebuilding its state on the way down
+		BitBoardState state{ tree.RootState };
+		promising_node = SelectNode(tree, worker, state);
+		end_phase(SearchPhase::Select);
 
-		// Choose a random child to run simulations on
-		MCTSNode* node_to_explore{ promising_node };
-		if (!promising_node->Children.empty())
+		// If the node isn't proven (which includes the game being over), make a new child node for all possible moves.
+		// When another thread is already expanding it, the simulation simply starts from the node itself
+		if (!tree.Nodes[promising_node].IsProven())
+			Expand(tree, promising_node, state);
+
+		// Choose a random child to run simulations on, a proven node is its own result
+		NodeIndex node_to_explore{ promising_node };
+		const MCTSNode& promising{ tree.Nodes[promising_node] };
+		const uint8_t nr_children{ promising.GetNrChildren() };
+		if (nr_children > 0 && !promising.IsProven())
+		{
+			int rnd_int{ GetRandomInt(worker, static_cast<int>(nr_children)) };
+			const NodeIndex edge_to_explore{ promising.FirstEdge + rnd_int };
+			MCTSEdge& edge{ tree.Edges[edge_to_explore] };
+			node_to_explore = edge.Child;
+
+			state.PlacePiece(edge.Move, state.GetCurrentPlayer());
+			edge.VisitCount.fetch_add(m_Settings.VirtualLoss, std::memory_order_relaxed);
+			tree.Nodes[node_to_explore].VisitCount.fetch_add(m_Settings.VirtualLoss, std::memory_order_relaxed);
+			worker.EdgePath.push_back(edge_to_explore);
+			worker.Path.push_back(node_to_explore);
+		}
+		end_phase(SearchPhase::Expand);
+
+		if (collect_report)
 		{
-			int rnd_int{ utils::GetRandomInt(static_cast<int>(promising_node->Children.size())) };
-			node_to_explore = promising_node->Children[rnd_int];
+			const int depth{ static_cast<int>(worker.Path.size()) - 1 };
+			worker.DepthSum += depth;
+			worker.MaxDepth = std::max(worker.MaxDepth, depth);
 		}
 
 		// Simulate the game of that move until it finishes (win or draw)
-		// Then propagate the result to all the parent nodes
-		BackPropagate(node_to_explore, Simulate(node_to_explore));
+		// Then propagate the results to all the nodes on the path
+		const RolloutResult result{ Rollout(tree, worker, node_to_explore, state) };
+		end_phase(SearchPhase::Simulate);
+		BackPropagate(tree, worker, result);
+		PropagateProofs(tree, worker);
+		end_phase(SearchPhase::BackPropagate);
+	}
+
+	m_NrIterations.fetch_add(i - nr_counted_iterations, std::memory_order_relaxed);
+	m_NrRollouts.fetch_add(std::exchange(worker.NrRollouts, 0), std::memory_order_relaxed);
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::ClaimIterations()
+{
+	// The budget can go negative once it is spent, the last claim only gets what was left
+	const int nr_left{ m_NrIterationsLeft.fetch_sub(LimitCheckInterval, std::memory_order_relaxed) };
+	return std::clamp(nr_left, 0, LimitCheckInterval);
+}
+
+template<typename Rules>
+bool MonteCarloTreeSearch<Rules>::IsBudgetSpent() const
+{
+	if (m_Limits.Time.count() > 0 && std::chrono::steady_clock::now() >= m_Deadline)
+		return true;
+
+	// Without a node limit as well, a time limited search or pondering can't grow the tree past what the arenas hold
+	for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+	{
+		if (tree->Nodes.IsNearlyFull() || tree->Edges.IsNearlyFull())
+			return true;
 	}
 
+	if (m_Limits.NrNodes > 0)
+	{
+		uint32_t nr_nodes{ 0 };
+		for (const std::unique_ptr<SearchTree>& tree : m_Trees)
+			nr_nodes += tree->Nodes.GetNrAllocated();
 
-	// Find node with most visits
-	MCTSNode* best_node{ m_RootNode->Children[0] };
-	for (const auto& child : m_RootNode->Children)
+		if (nr_nodes >= m_Limits.NrNodes)
+			return true;
+	}
+
+	return false;
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::SetRoot(SearchTree& tree, const BitBoardState& state)
+{
+	// Continue from the node of this position if the previous search already reached it
+	if (m_Settings.ReuseTree && tree.RootNode != INVALID_NODE)
 	{
-		if (child->VisitCount > best_node->VisitCount)
-			best_node = child;
+		const NodeIndex new_root{ FindNode(tree, state) };
+		if (new_root != INVALID_NODE)
+		{
+			// Searching the same position again, e.g. after pondering, keeps the arenas as they are,
+			// everything in them is still reachable from the root
+			if (new_root != tree.RootNode)
+				PromoteToRoot(tree, new_root, state);
+			tree.RootState = state;
+
+			// A leaf proven by the endgame solver has no children to pick a move from yet
+			MCTSNode& root{ tree.Nodes[tree.RootNode] };
+			if (root.IsLeaf())
+				root.NodeProof.store(Proof::Unknown, std::memory_order_relaxed);
+			return;
+		}
 	}
 
-	delete m_RootNode;
-	m_RootNode = nullptr;
+	// Throw away the previous tree, the arenas keep their memory for this search
+	tree.Nodes.Reset();
+	tree.Edges.Reset();
+	tree.Table.Clear();
+	tree.RootNode = tree.Nodes.Allocate();
+	tree.RootState = state;
+	if (m_Settings.UseTranspositions)
+		tree.Table.FindOrInsert(state.GetHash(), tree.RootNode);
+}
 
-	return best_node->State.GetLastMove();
+template<typename Rules>
+NodeIndex MonteCarloTreeSearch<Rules>::FindNode(const SearchTree& tree, const BitBoardState& state) const
+{
+	if (state.GetP1Piece() != tree.RootState.GetP1Piece() || state.GetP2Piece() != tree.RootState.GetP2Piece())
+		return INVALID_NODE;
+
+	NodeIndex current_node{ tree.RootNode };
+	BitBoardState current_state{ tree.RootState };
+
+	// Follow the pieces that were added since the root, e.g. our move and the opponent's reply
+	while (current_state.GetNrPieces() < state.GetNrPieces())
+	{
+		const MCTSNode& current{ tree.Nodes[current_node] };
+		NodeIndex next_node{ INVALID_NODE };
+		int next_move{ INVALID_INDEX };
+
+		for (NodeIndex edge{ current.FirstEdge }; edge < current.FirstEdge + current.GetNrChildren(); ++edge)
+		{
+			const int move{ tree.Edges[edge].Move };
+			const int row{ current_state.GetHeight(move) };
+			if (row < state.GetHeight(move) && state.GetCell(row, move) == current_state.GetCurrentPlayer())
+			{
+				next_node = tree.Edges[edge].Child;
+				next_move = move;
+				break;
+			}
+		}
+
+		// The position was never reached by the tree
+		if (next_node == INVALID_NODE)
+			return INVALID_NODE;
+
+		current_node = next_node;
+		current_state.PlacePiece(next_move, current_state.GetCurrentPlayer());
+	}
+
+	return current_state == state ? current_node : INVALID_NODE;
 }
 
-MCTSNode* MonteCarloTreeSearch::SelectNode(MCTSNode* fromNode)
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::PromoteToRoot(SearchTree& tree, NodeIndex newRoot, const BitBoardState& newRootState)
 {
+	// Copy the subgraph breadth first into the spare arenas, the spare table makes sure
+	// a position reached through several parents is still copied once.
+	// Everything outside of it is pruned when the old arenas are reset.
+	tree.SpareNodes.Reset();
+	tree.SpareEdges.Reset();
+	tree.SpareTable.Clear();
+	tree.SpareTable.Reserve(tree.Table.GetNrEntries());
+	tree.CopyQueue.clear();
+
+	const NodeIndex copied_root{ tree.SpareNodes.Allocate() };
+	tree.SpareNodes[copied_root] = tree.Nodes[newRoot];
+	tree.CopyQueue.push_back({ newRoot, copied_root, newRootState });
+	if (m_Settings.UseTranspositions)
+		tree.SpareTable.FindOrInsert(newRootState.GetHash(), copied_root);
+
+	for (size_t i{ 0 }; i < tree.CopyQueue.size(); ++i)
+	{
+		const SearchTree::CopyEntry entry{ tree.CopyQueue[i] };
+		const MCTSNode& old_parent{ tree.Nodes[entry.OldNode] };
+		if (old_parent.IsLeaf())
+			continue;
+
+		const uint8_t nr_children{ old_parent.GetNrChildren() };
+		const NodeIndex first_edge{ tree.SpareEdges.Allocate(nr_children) };
+		for (uint32_t child{ 0 }; child < nr_children; ++child)
+		{
+			const MCTSEdge& old_edge{ tree.Edges[old_parent.FirstEdge + child] };
+			BitBoardState child_state{ entry.State };
+			child_state.PlacePiece(old_edge.Move, child_state.GetCurrentPlayer());
+
+			auto copy_child = [&tree, &old_edge, &child_state]()
+				{
+					const NodeIndex copied_child{ tree.SpareNodes.Allocate() };
+					tree.SpareNodes[copied_child] = tree.Nodes[old_edge.Child];
+					tree.CopyQueue.push_back({ old_edge.Child, copied_child, child_state });
+					return copied_child;
+				};
+
+			const NodeIndex new_child{ m_Settings.UseTranspositions ? tree.SpareTable.FindOrAdd(child_state.GetHash(), copy_child) : copy_child() };
+
+			MCTSEdge& new_edge{ tree.SpareEdges[first_edge + child] };
+			new_edge = old_edge;
+			new_edge.Child = new_child;
+		}
+		tree.SpareNodes[entry.NewNode].FirstEdge = first_edge;
+	}
+
+	tree.Nodes.Swap(tree.SpareNodes);
+	tree.Edges.Swap(tree.SpareEdges);
+	tree.Table.Swap(tree.SpareTable);
+	tree.SpareNodes.Reset();
+	tree.SpareEdges.Reset();
+	tree.SpareTable.Clear();
+	tree.RootNode = copied_root;
+}
+
+template<typename Rules>
+NodeIndex MonteCarloTreeSearch<Rules>::SelectNode(SearchTree& tree, SearchWorker& worker, BitBoardState& state)
+{
+	MCTS_PROFILE_SCOPE(ProfileZone::Select);
+
 	//Start
-	MCTSNode* current_node{ fromNode };
+	NodeIndex current_node{ tree.RootNode };
 
-	if (!current_node)
-		return nullptr;
+	worker.Path.clear();
+	worker.EdgePath.clear();
+	if (current_node == INVALID_NODE)
+		return INVALID_NODE;
 
-	// Find leaf node
-	while (!current_node->IsLeaf())
+	// Every node on the path counts as visited (and lost) until the result is propagated
+	tree.Nodes[current_node].VisitCount.fetch_add(m_Settings.VirtualLoss, std::memory_order_relaxed);
+	worker.Path.push_back(current_node);
+
+	// Find leaf node, or a proven node which needs no further search
+	while (!tree.Nodes[current_node].IsLeaf() && !tree.Nodes[current_node].IsProven())
 	{
-		MCTSNode* highest_UCB_node{ current_node->Children[0] };
-		float highest_UCB{ CalculateUCB(*highest_UCB_node) };
+		MCTSNode& current{ tree.Nodes[current_node] };
+		const uint8_t nr_children{ current.GetNrChildren() };
+		NodeIndex highest_UCB_edge{ INVALID_NODE };
+		float highest_UCB{ 0.0f };
+		bool has_winning_child{ false };
 
-		// Find child node that maximises Upper Confidence Boundary
-		for (auto& child : current_node->Children)
+		// Find child node that maximises Upper Confidence Boundary, proven children are settled and skipped
+		for (NodeIndex edge{ current.FirstEdge }; edge < current.FirstEdge + nr_children; ++edge)
 		{
-			float child_UCB{ CalculateUCB(*child) };
-			if (child_UCB > highest_UCB)
+			const Proof child_proof{ tree.Nodes[tree.Edges[edge].Child].GetProof() };
+			if (child_proof == Proof::Win)
+			{
+				has_winning_child = true;
+				break;
+			}
+			if (child_proof != Proof::Unknown)
+				continue;
+
+			float child_UCB{ CalculateUCB(tree, tree.Edges[edge]) };
+			if (highest_UCB_edge == INVALID_NODE || child_UCB > highest_UCB)
 			{
 				highest_UCB = child_UCB;
-				highest_UCB_node = child;
+				highest_UCB_edge = edge;
 			}
 		}
 
-		current_node = highest_UCB_node;
+		// The children prove the node. With transpositions they can be proven through another parent,
+		// before anything was propagated to this one
+		if (has_winning_child || highest_UCB_edge == INVALID_NODE)
+		{
+			current.NodeProof.store(GetProofFromChildren(tree, current_node), std::memory_order_relaxed);
+			break;
+		}
+
+		// Play the move of the chosen child to keep the state in sync with the node
+		MCTSEdge& chosen_edge{ tree.Edges[highest_UCB_edge] };
+		current_node = chosen_edge.Child;
+		state.PlacePiece(chosen_edge.Move, state.GetCurrentPlayer());
+		chosen_edge.VisitCount.fetch_add(m_Settings.VirtualLoss, std::memory_order_relaxed);
+		tree.Nodes[current_node].VisitCount.fetch_add(m_Settings.VirtualLoss, std::memory_order_relaxed);
+		worker.EdgePath.push_back(highest_UCB_edge);
+		worker.Path.push_back(current_node);
 	}
 
 	return current_node;
 }
 
-void MonteCarloTreeSearch::Expand(MCTSNode*& fromNode)
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::Expand(SearchTree& tree, NodeIndex fromNode, const BitBoardState& state)
 {
-	// For each available action from current state, add new state to the tree
-	const auto& available_actions{ m_pStateAnalysis->GetAvailableActions(fromNode->State) };
+	MCTS_PROFILE_SCOPE(ProfileZone::Expand);
 
-	std::vector<MCTSNode*> new_children{};
-	for (const auto& action : available_actions)
-	{
-		// Make a copy of the board state
-		GameState new_state{ fromNode->State };
+	// Claim the node, only one thread gets to expand it
+	MCTSNode& from_node{ tree.Nodes[fromNode] };
+	uint8_t nr_children{ 0 };
+	if (!from_node.NrChildren.compare_exchange_strong(nr_children, MCTSNode::Expanding, std::memory_order_acquire))
+		return;
 
-		// Play the available action
-		new_state.PlacePiece(action, new_state.IsPlayer1Turn()
-			? new_state.GetP1Piece() : new_state.GetP2Piece());
+	// For each available action from current state, add new node to the tree
+	const MoveList available_actions{ m_Rules.GetAvailableActions(state) };
+	if (available_actions.empty())
+	{
+		from_node.NrChildren.store(0, std::memory_order_release);
+		return;
+	}
 
-		// Create new child node
-		MCTSNode* new_node{ new MCTSNode(new_state) };
-		new_node->Parent = fromNode;
-		new_children.push_back(new_node);
+	// All edges are allocated in one go so they end up next to each other.
+	// Once an arena is full the node stays a leaf, its simulations then start from the node itself
+	const NodeIndex first_edge{ tree.Edges.Allocate(available_actions.size()) };
+	if (first_edge == INVALID_NODE)
+	{
+		from_node.NrChildren.store(0, std::memory_order_release);
+		return;
 	}
 
-	// Add newly generated children to the node
-	for (auto new_child : new_children)
+	for (int i{ 0 }; i < available_actions.size(); ++i)
 	{
-		fromNode->Children.emplace_back(new_child);
+		const int action{ available_actions[i] };
+
+		// Play the available action on a copy of the board state
+		BitBoardState new_state{ state };
+		new_state.PlacePiece(action, new_state.GetCurrentPlayer());
+
+		MCTSEdge& new_edge{ tree.Edges[first_edge + i] };
+		new_edge.Child = FindOrAddNode(tree, new_state, action);
+		new_edge.Move = static_cast<int8_t>(action);
+		if (new_edge.Child == INVALID_NODE)
+		{
+			from_node.NrChildren.store(0, std::memory_order_release);
+			return;
+		}
 	}
+
+	// Add newly generated children to the node, publishing the count makes them visible to the other threads
+	from_node.FirstEdge = first_edge;
+	from_node.NrChildren.store(static_cast<uint8_t>(available_actions.size()), std::memory_order_release);
 }
 
+template<typename Rules>
+NodeIndex MonteCarloTreeSearch<Rules>::FindOrAddNode(SearchTree& tree, const BitBoardState& state, int lastMove)
+{
+	// Only the player who just moved can have won
+	const bool is_win{ m_Rules.CheckWinAfterMove(state, lastMove) };
+	const bool is_terminal{ is_win || m_Rules.CheckDraw(state) };
+
+	auto add_node = [&tree, is_win, is_terminal]()
+		{
+			const NodeIndex node{ tree.Nodes.Allocate() };
+			if (node == INVALID_NODE)
+				return node;
+
+			tree.Nodes[node].IsTerminal = is_terminal;
+			if (is_terminal)
+				tree.Nodes[node].NodeProof.store(is_win ? Proof::Win : Proof::Draw, std::memory_order_relaxed);
+			return node;
+		};
+
+	// Another move order may already have reached this position
+	if (m_Settings.UseTranspositions)
+		return tree.Table.FindOrAdd(state.GetHash(), add_node);
+
+	return add_node();
+}
+
+template<typename Rules>
+RolloutResult MonteCarloTreeSearch<Rules>::Rollout(SearchTree& tree, SearchWorker& worker, NodeIndex node, const BitBoardState& state)
+{
+	// Proven nodes, the ones where the game is over included, always end the same way
+	const Proof proof{ tree.Nodes[node].GetProof() };
+	if (proof != Proof::Unknown)
+		return GetProvenResult(state, proof);
+
+	const int nr_rollouts{ m_Settings.NrRollouts };
+	worker.Winners.resize(nr_rollouts);
+
+	bool use_batches{ false };
+	if constexpr (std::is_same_v<Rules, C4_Analysis>)
+	{
+		// Close to the end of the game the exact result is cheaper than a handful of noisy rollouts.
+		// The leaf is proven by it, so it is solved only once
+		const int nr_empty_cells{ BitBoardState::NrRows * BitBoardState::NrColumns - state.GetNrPieces() };
+		if (nr_empty_cells <= m_Settings.SolverEmptyCells)
+		{
+			MCTS_PROFILE_SCOPE(ProfileZone::Solve);
+			const int value{ worker.Solver.Solve(state) };
+			if (m_CollectReport)
+				++worker.NrSolvedLeaves;
+
+			// The solver's value is for the player to move, the proof for the player who moved last
+			const Proof solved_proof{ value == EndgameSolver::Win ? Proof::Loss : value == EndgameSolver::Loss ? Proof::Win : Proof::Draw };
+			tree.Nodes[node].NodeProof.store(solved_proof, std::memory_order_relaxed);
+			return GetProvenResult(state, solved_proof);
+		}
+
+		use_batches = m_Settings.BatchRollouts && nr_rollouts > 1;
+	}
+
+	if (use_batches)
+	{
+		// In leaf parallel mode the rollouts are split over all threads of the pool first, every thread plays its share
+		// as one batch. A single batch of all rollouts would leave the other threads idle for NrRollouts <= BatchSize
+		const int nr_jobs{ m_pRolloutPool ? std::min(m_pRolloutPool->GetNrThreads(), nr_rollouts) : 1 };
+		const int nr_games_per_job{ (nr_rollouts + nr_jobs - 1) / nr_jobs };
+		auto play_games = [&worker, &state, nr_rollouts, nr_games_per_job](RandomEngine& random, int job)
+			{
+				MCTS_PROFILE_SCOPE(ProfileZone::Simulate);
+
+				const int first_rollout{ job * nr_games_per_job };
+				const int nr_games{ std::min(nr_games_per_job, nr_rollouts - first_rollout) };
+				if (nr_games > 0)
+					BatchRollout::Play(state, random, &worker.Winners[first_rollout], nr_games);
+			};
+
+		if (m_pRolloutPool)
+			m_pRolloutPool->Run(nr_jobs, [this, &play_games](int threadIdx, int job) { play_games(m_Workers[threadIdx].Random, job); });
+		else
+			play_games(worker.Random, 0);
+	}
+	else if (m_pRolloutPool && nr_rollouts > 1)
+	{
+		// Every thread of the pool simulates with the random engine of its own worker
+		m_pRolloutPool->Run(nr_rollouts, [&](int threadIdx, int rollout)
+			{
+				BitBoardState state_copy{ state };
+				worker.Winners[rollout] = Simulate(tree, m_Workers[threadIdx], node, state_copy);
+			});
+	}
+	else
+	{
+		for (int rollout{ 0 }; rollout < nr_rollouts; ++rollout)
+		{
+			BitBoardState state_copy{ state };
+			worker.Winners[rollout] = Simulate(tree, worker, node, state_copy);
+		}
+	}
+
+	worker.NrRollouts += nr_rollouts;
+
+	RolloutResult result{};
+	result.NrRollouts = static_cast<uint32_t>(nr_rollouts);
+	for (const char winner : worker.Winners)
+	{
+		if (winner == state.GetP1Piece())
+			++result.NrPlayer1Wins;
+		else if (winner == state.GetP2Piece())
+			++result.NrPlayer2Wins;
+	}
+	return result;
+}
 
 /* After Expansion, the algorithm picks a child node arbitrarily,
 and it simulates a randomized game from selected node until it reaches the resulting state of the game.*/
 //Simulate game on node randomly, returns winner color if there is one, empty color if draw
-char MonteCarloTreeSearch::Simulate(MCTSNode* node)
+template<typename Rules>
+char MonteCarloTreeSearch<Rules>::Simulate(SearchTree& tree, SearchWorker& worker, NodeIndex node, BitBoardState& state_copy)
 {
-	// Create a copy to run the simulation on
-	GameState state_copy{ node->State };
+	MCTS_PROFILE_SCOPE(ProfileZone::Simulate);
+
+	// The game already ended in this node, nothing left to simulate
+	if (tree.Nodes[node].IsTerminal)
+		return tree.Nodes[node].GetProof() == Proof::Win ? state_copy.GetWaitingPlayer() : EMPTY;
 
 	// Loop until game ends
 	while (true)
 	{
 		// Play a random move
-		const auto available_actions{ m_pStateAnalysis->GetAvailableActions(state_copy) };
-		if (!available_actions.empty())
-		{
-			int rnd_idx{ utils::GetRandomInt(static_cast<int>(available_actions.size())) };
-			state_copy.PlacePiece(available_actions[rnd_idx], state_copy.GetCurrentPlayer());
-		}
+		const MoveList available_actions{ m_Rules.GetAvailableActions(state_copy) };
+		if (available_actions.empty())
+			return EMPTY;
 
-		// Check if game is over and return the winner
-		if (m_pStateAnalysis->CheckWin(state_copy, state_copy.GetCurrentPlayer()))
-			return state_copy.GetCurrentPlayer();
+		int rnd_idx{ GetRandomInt(worker, static_cast<int>(available_actions.size())) };
+		const int move{ available_actions[rnd_idx] };
+		state_copy.PlacePiece(move, state_copy.GetCurrentPlayer());
 
-		if (m_pStateAnalysis->CheckWin(state_copy, state_copy.GetWaitingPlayer()))
+		// Check if game is over and return the winner, only the player who just moved can have won
+		if (m_Rules.CheckWinAfterMove(state_copy, move))
 			return state_copy.GetWaitingPlayer();
 
-		if (m_pStateAnalysis->CheckDraw(state_copy))
+		if (m_Rules.CheckDraw(state_copy))
 			return EMPTY;
 	}
 }
@@ -168,49 +896,140 @@ char MonteCarloTreeSearch::Simulate(MCTSNode* node)
  Once the algorithm reaches the end of the game,
  it evaluates the state to figure out which player has won.
  It traverses upwards to the root and increments visit score for all visited nodes.
- It also updates win score for each node if the player for that position has won the playout.
+ It also updates win score for each node if the player who made its move has won the playout.
 */
-void MonteCarloTreeSearch::BackPropagate(MCTSNode* fromNode, const char& winningPlayer)
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::BackPropagate(SearchTree& tree, const SearchWorker& worker, const RolloutResult& result)
 {
-	MCTSNode* current_node{ fromNode };
-	int reward{ 0 };
+	MCTS_PROFILE_SCOPE(ProfileZone::BackPropagate);
 
-	// Check if the AI won the simulation
-	if (!fromNode->State.IsPlayerTurn(m_pPlayer->GetInitial()) && winningPlayer == m_pPlayer->GetInitial())
-		reward = 1;
+	// The root's move was made by the player waiting in the root state, from there the players alternate
+	char mover{ tree.RootState.GetWaitingPlayer() };
 
-	// While there is a parent node to visit
-	while (current_node != nullptr)
+	for (size_t i{ 0 }; i < worker.Path.size(); ++i)
 	{
-		++current_node->VisitCount;
+		MCTSNode& current{ tree.Nodes[worker.Path[i]] };
 
-		// If the AI won the simulation
-		if (winningPlayer == m_pPlayer->GetInitial())
-			current_node->WinCount += reward;
+		// Turn the virtual loss into the real visits (unsigned wrap around keeps this right for any loss)
+		current.VisitCount.fetch_add(result.NrRollouts - m_Settings.VirtualLoss, std::memory_order_relaxed);
+		if (i > 0)
+			tree.Edges[worker.EdgePath[i - 1]].VisitCount.fetch_add(result.NrRollouts - m_Settings.VirtualLoss, std::memory_order_relaxed);
 
-		current_node = current_node->Parent;
+		// A draw doesn't reward anyone
+		const uint32_t nr_wins{ mover == tree.RootState.GetP1Piece() ? result.NrPlayer1Wins : result.NrPlayer2Wins };
+		if (nr_wins > 0)
+			current.WinCount.fetch_add(nr_wins, std::memory_order_relaxed);
 
-		// If the game ended in a tie, set the reward to 0
-		if (winningPlayer == EMPTY)
-			reward = 0;
-		// Otherwise, switch the reward between 1 and 0
-		else
-			reward = 1 - reward;
+		mover = tree.RootState.GetOpponentPiece(mover);
+	}
+}
+
+template<typename Rules>
+Proof MonteCarloTreeSearch<Rules>::GetProofFromChildren(const SearchTree& tree, NodeIndex node) const
+{
+	const MCTSNode& parent{ tree.Nodes[node] };
+	const uint8_t nr_children{ parent.GetNrChildren() };
+	if (nr_children == 0)
+		return Proof::Unknown;
+
+	// The proofs of the children are for the player to move in the node: one winning move is enough for them,
+	// and the player who moved last only wins when every move loses
+	bool is_proven{ true };
+	bool can_draw{ false };
+	for (NodeIndex edge{ parent.FirstEdge }; edge < parent.FirstEdge + nr_children; ++edge)
+	{
+		switch (tree.Nodes[tree.Edges[edge].Child].GetProof())
+		{
+		case Proof::Win:
+			return Proof::Loss;
+		case Proof::Draw:
+			can_draw = true;
+			break;
+		case Proof::Unknown:
+			is_proven = false;
+			break;
+		case Proof::Loss:
+			break;
+		}
+	}
+
+	if (!is_proven)
+		return Proof::Unknown;
+
+	return can_draw ? Proof::Draw : Proof::Win;
+}
+
+template<typename Rules>
+void MonteCarloTreeSearch<Rules>::PropagateProofs(SearchTree& tree, const SearchWorker& worker)
+{
+	// Only the last node of the path can have been proven by this iteration
+	if (worker.Path.empty() || !tree.Nodes[worker.Path.back()].IsProven())
+		return;
+
+	for (size_t i{ worker.Path.size() - 1 }; i-- > 0;)
+	{
+		MCTSNode& node{ tree.Nodes[worker.Path[i]] };
+		// Another thread may have proven it meanwhile, its parent may still need the proof
+		if (node.IsProven())
+			continue;
+
+		const Proof proof{ GetProofFromChildren(tree, worker.Path[i]) };
+		if (proof == Proof::Unknown)
+			return;
+
+		node.NodeProof.store(proof, std::memory_order_relaxed);
 	}
 }
 
-float MonteCarloTreeSearch::CalculateUCB(const MCTSNode& node) const
+template<typename Rules>
+RolloutResult MonteCarloTreeSearch<Rules>::GetProvenResult(const BitBoardState& state, Proof proof) const
+{
+	// They count as many rollouts, so a proven leaf weighs as much as any other leaf
+	RolloutResult result{};
+	result.NrRollouts = static_cast<uint32_t>(m_Settings.NrRollouts);
+	if (proof == Proof::Draw)
+		return result;
+
+	// The proof is for the player who played the last move, the one waiting in state
+	const char winner{ proof == Proof::Win ? state.GetWaitingPlayer() : state.GetCurrentPlayer() };
+	if (winner == state.GetP1Piece())
+		result.NrPlayer1Wins = result.NrRollouts;
+	else
+		result.NrPlayer2Wins = result.NrRollouts;
+	return result;
+}
+
+template<typename Rules>
+int MonteCarloTreeSearch<Rules>::GetRandomInt(SearchWorker& worker, int max) const
+{
+	if (max <= 1)
+		return 0;
+
+	return static_cast<int>(worker.Random.NextBelow(static_cast<uint32_t>(max)));
+}
+
+template<typename Rules>
+float MonteCarloTreeSearch<Rules>::CalculateUCB(const SearchTree& tree, const MCTSEdge& edge) const
 {
-	if (node.VisitCount == 0)
+	// Other threads keep updating the statistics, a slightly stale read only nudges the selection
+	const MCTSNode& node{ tree.Nodes[edge.Child] };
+	const uint32_t visit_count{ node.VisitCount.load(std::memory_order_relaxed) };
+	const uint32_t edge_visit_count{ edge.VisitCount.load(std::memory_order_relaxed) };
+	if (visit_count == 0 || edge_visit_count == 0)
 		return FLT_MAX;
 
 	float UCB{ 0 };
 
-	// Calculate Exploitation
-	UCB += static_cast<float>(node.WinCount) / static_cast<float>(node.VisitCount);
+	// Calculate Exploitation, from every visit of the position
+	UCB += static_cast<float>(node.WinCount.load(std::memory_order_relaxed)) / static_cast<float>(visit_count);
 
-	// Calculate Exploration
-	UCB += 1.41f * sqrtf(static_cast<float>(m_RootNode->VisitCount) / static_cast<float>(node.VisitCount));
+	// Calculate Exploration, from the visits through this parent
+	const uint32_t root_visit_count{ tree.Nodes[tree.RootNode].VisitCount.load(std::memory_order_relaxed) };
+	UCB += 1.41f * sqrtf(static_cast<float>(root_visit_count) / static_cast<float>(edge_visit_count));
 
 	return UCB;
 }
+
+// The engine is instantiated for the compiled-in Connect 4 rules and for rules selected at runtime
+template class MonteCarloTreeSearch<C4_Analysis>;
+template class MonteCarloTreeSearch<StateAnalysisRules>;
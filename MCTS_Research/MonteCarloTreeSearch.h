@@ -1,68 +1,321 @@
 #pragma once
 #include <array>
+#include <atomic>
+#include <chrono>
 #include <memory>
-#include "Board.h"
+#include <thread>
+#include <utility>
+#include <vector>
+#include "GameState.h"
+#include "BitBoardState.h"
+#include "EndgameSolver.h"
+#include "NodeArena.h"
+#include "RandomEngine.h"
+#include "SearchReport.h"
+#include "TranspositionTable.h"
+#include "WorkerPool.h"
 
-struct StateAnalysis;
+class Player;
 
+
+// Game theoretic value of a node once the search knows it for sure,
+// for the player who played the last move of the position like WinCount
+enum class Proof : uint8_t
+{
+	Unknown,
+	Win,
+	Loss,
+	Draw
+};
+
+// A node is a position, the same position reached through different move orders shares one node,
+// which turns the tree into a DAG. Nodes don't store their position, the search rebuilds it while descending.
+// Statistics and the child count are atomic so several threads can grow one tree.
 struct MCTSNode
 {
-	MCTSNode() {};
+	// NrChildren while another thread is expanding the node
+	static constexpr uint8_t Expanding{ UINT8_MAX };
 
-	MCTSNode(const GameState& state)
-		: State(state) {};
+	MCTSNode() = default;
+	MCTSNode(const MCTSNode& other) { *this = other; };
+	MCTSNode& operator=(const MCTSNode& other)
+	{
+		VisitCount.store(other.VisitCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		WinCount.store(other.WinCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		FirstEdge = other.FirstEdge;
+		NrChildren.store(other.NrChildren.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		IsTerminal = other.IsTerminal;
+		NodeProof.store(other.NodeProof.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		return *this;
+	}
 
-	MCTSNode(const MCTSNode& other)
-		: WinCount(other.WinCount), VisitCount(other.VisitCount), Children(other.Children), Parent(other.Parent), State(other.State) {};
+	std::atomic<uint32_t> VisitCount{ 0 };
+	// Wins of the player who played the last move of the position
+	std::atomic<uint32_t> WinCount{ 0 };
+	// The edges to the children are stored next to each other in the search's edge arena.
+	// FirstEdge is only valid once NrChildren is published
+	NodeIndex FirstEdge{ INVALID_NODE };
+	std::atomic<uint8_t> NrChildren{ 0 };
+	// Set when the last move ended the game, the node is then proven a win or a draw
+	bool IsTerminal{ false };
+	// Proven nodes are settled, the search doesn't select into them anymore
+	std::atomic<Proof> NodeProof{ Proof::Unknown };
 
-	~MCTSNode()
+	// Number of children once expanded, 0 for leaves and nodes that are still being expanded
+	uint8_t GetNrChildren() const
 	{
-		for (auto& child : Children)
-		{
-			delete child;
-			child = nullptr;
-		}
-		Children.clear();
+		const uint8_t nr_children{ NrChildren.load(std::memory_order_acquire) };
+		return nr_children == Expanding ? 0 : nr_children;
 	}
-	MCTSNode& operator=(const MCTSNode& other)
+	bool IsLeaf() const { return GetNrChildren() == 0; }
+	Proof GetProof() const { return NodeProof.load(std::memory_order_relaxed); }
+	bool IsProven() const { return GetProof() != Proof::Unknown; }
+};
+static_assert(sizeof(MCTSNode) <= 16, "MCTSNode should stay compact, the upper tree has to fit in cache");
+
+// Move from a node to one of its children.
+// The child's statistics are shared by all its parents, the edge counts the visits through this parent.
+// The exploration term weighs those against the visits of the root, like the original formula did
+struct MCTSEdge
+{
+	MCTSEdge() = default;
+	MCTSEdge(NodeIndex child, int8_t move) : Child{ child }, Move{ move } {};
+	MCTSEdge(const MCTSEdge& other) { *this = other; };
+	MCTSEdge& operator=(const MCTSEdge& other)
 	{
-		VisitCount = other.VisitCount;
-		WinCount = other.WinCount;
-		State = other.State;
-		Children = other.Children;
+		Child = other.Child;
+		VisitCount.store(other.VisitCount.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		Move = other.Move;
 		return *this;
 	}
-	MCTSNode& operator=(MCTSNode&& other) = delete;
-	MCTSNode(MCTSNode&& other) = delete;
-
-	// State of the game in this node
-	GameState State;
-	UINT VisitCount{ 0 };
-	UINT WinCount{ 0 };
-	MCTSNode* Parent{nullptr};
-	std::vector<MCTSNode*> Children{};
-	bool IsLeaf() const { return Children.empty(); }
+
+	NodeIndex Child{ INVALID_NODE };
+	std::atomic<uint32_t> VisitCount{ 0 };
+	int8_t Move{ INVALID_INDEX };
+};
+
+enum class ParallelMode
+{
+	// Every thread grows its own tree from the same root, their root statistics are merged at the end
+	Root,
+	// All threads grow one shared tree, virtual loss spreads them over different paths
+	Tree,
+	// One thread grows the tree, the rollouts of every selected leaf are spread over all threads
+	Leaf
 };
 
+// A search stops at whichever limit it reaches first, limits set to 0 are ignored.
+// It also stops when its node arenas are close to full, whatever the limits
+struct SearchLimits
+{
+	// Iterations of the search. The threads of a shared tree (ParallelMode::Tree) split them between them,
+	// in ParallelMode::Root every thread runs this many on its own tree
+	int NrIterations{ 10000 };
+	// Nodes in all trees of the search, including the ones kept from the previous search
+	uint32_t NrNodes{ 0 };
+	// Wall clock time of the search
+	std::chrono::milliseconds Time{ 0 };
+};
+
+struct MCTSSettings
+{
+	SearchLimits Limits{};
+	// Pondering searches until it is stopped, the node limit keeps it from eating all memory
+	SearchLimits PonderLimits{ 0, 4'000'000 };
+	// Rollouts played from every selected leaf, their results are propagated together
+	int NrRollouts{ 1 };
+	// Play the rollouts of a leaf in lockstep batches, vectorized where the CPU has AVX2.
+	// Only used with the C4_Analysis rules, the batches play by the standard Connect 4 rules themselves
+	bool BatchRollouts{ true };
+	// Leaves with at most this many empty cells are solved exactly instead of played out, 0 turns the solver off.
+	// Only used with the C4_Analysis rules, the solver plays by the standard Connect 4 rules itself
+	int SolverEmptyCells{ 12 };
+	int NrThreads{ 1 };
+	ParallelMode Parallelism{ ParallelMode::Root };
+	// Visits added to the nodes of a selected path until its result is propagated,
+	// makes the path look worse to the other threads of a shared tree
+	uint32_t VirtualLoss{ 3 };
+	// Keep the subtree of the position we get next time, instead of starting from scratch
+	bool ReuseTree{ true };
+	// Share the node of a position between all move orders that lead to it
+	bool UseTranspositions{ true };
+	// Seed of the rollouts, 0 picks a random one. With a fixed seed a single thread or
+	// root parallel search plays the same games every run, shared trees still depend on thread timing
+	uint64_t Seed{ 0 };
+	// Time the phases of every iteration and keep a SearchReport of every search, see GetReport
+	bool CollectReport{ false };
+};
+
+// Snapshot of a running search, cheap enough to take every frame
+struct SearchProgress
+{
+	uint64_t NrIterations{ 0 };
+	// Rollouts actually played, leaves that are proven or solved don't need any
+	uint64_t NrRollouts{ 0 };
+	uint32_t NrNodes{ 0 };
+	std::chrono::milliseconds Time{ 0 };
+	// Move with the most visits so far, INVALID_INDEX before the root is expanded
+	int BestMove{ INVALID_INDEX };
+};
+
+// A tree and its root, shared by all threads in ParallelMode::Tree
+struct SearchTree
+{
+	NodeArena<MCTSNode> Nodes{};
+	NodeArena<MCTSEdge> Edges{};
+	// Node of every position in the tree, by Zobrist hash
+	TranspositionTable Table{};
+	NodeIndex RootNode{ INVALID_NODE };
+	BitBoardState RootState{};
+
+	// A kept subtree is copied into the spare arenas, which then become the tree
+	NodeArena<MCTSNode> SpareNodes{};
+	NodeArena<MCTSEdge> SpareEdges{};
+	TranspositionTable SpareTable{};
+	struct CopyEntry
+	{
+		NodeIndex OldNode;
+		NodeIndex NewNode;
+		BitBoardState State;
+	};
+	std::vector<CopyEntry> CopyQueue{};
+};
+
+// What every search thread needs for itself
+struct SearchWorker
+{
+	// Nodes visited by the current iteration, from the root down, and the edges between them
+	std::vector<NodeIndex> Path{};
+	std::vector<NodeIndex> EdgePath{};
+	// Winner of every rollout of the current iteration
+	std::vector<char> Winners{};
+	RandomEngine Random{};
+	// Keeps its transposition table from one solved leaf to the next
+	EndgameSolver Solver{};
+	// Rollouts played since the search last added them to its total
+	uint64_t NrRollouts{ 0 };
+
+	// Only kept when the search collects a report
+	std::array<std::chrono::nanoseconds, NrSearchPhases> PhaseTimes{};
+	uint64_t DepthSum{ 0 };
+	int MaxDepth{ 0 };
+	uint64_t NrSolvedLeaves{ 0 };
+};
+
+// Outcome of all rollouts played from one leaf
+struct RolloutResult
+{
+	uint32_t NrRollouts{ 0 };
+	uint32_t NrPlayer1Wins{ 0 };
+	uint32_t NrPlayer2Wins{ 0 };
+};
+
+// Rules is the game rules policy, bound at compile time so the rollout loop can inline it.
+// It has to provide GetAvailableActions, CheckWinAfterMove and CheckDraw for a BitBoardState,
+// C4_Analysis does so directly and StateAnalysisRules forwards to any StateAnalysis picked at runtime.
+// Rules are shared by all search threads, so they have to be safe to call concurrently.
+template<typename Rules>
 class MonteCarloTreeSearch final
 {
 public:
-	MonteCarloTreeSearch(Player* player);
+	MonteCarloTreeSearch(Player* player, const MCTSSettings& settings = MCTSSettings{}, const Rules& rules = Rules{});
 	~MonteCarloTreeSearch();
+
+	MonteCarloTreeSearch(const MonteCarloTreeSearch& other) = delete;
+	MonteCarloTreeSearch& operator=(const MonteCarloTreeSearch& other) = delete;
+	MonteCarloTreeSearch(MonteCarloTreeSearch&& other) = delete;
+	MonteCarloTreeSearch& operator=(MonteCarloTreeSearch&& other) = delete;
+	// Searches with the limits of the settings, or with the given ones, and returns the best move found
 	int FindNextMove(const GameState& pBoard);
+	int FindNextMove(const GameState& pBoard, const SearchLimits& limits);
+	// Also collects the report of this search, whatever the settings say
+	int FindNextMove(const GameState& pBoard, const SearchLimits& limits, SearchReport& report);
+
+	// Same search on a background thread, so the caller can keep rendering and poll for the result
+	void StartSearch(const GameState& pBoard);
+	void StartSearch(const GameState& pBoard, const SearchLimits& limits);
+	bool IsSearchDone() const { return m_SearchDone.load(std::memory_order_acquire); };
+	SearchProgress GetProgress() const;
+	// Stops the search early, the result is then the best move found so far
+	void CancelSearch();
+	// Waits for the search to finish and returns the best move
+	int GetSearchResult();
+
+	// Keeps searching the position in the background while the opponent thinks.
+	// The next search stops it and continues from the subtree of the move the opponent played
+	void StartPondering(const GameState& pBoard);
+	void StopPondering();
+	bool IsPondering() const { return m_IsPondering; };
+
+	const MCTSSettings& GetSettings() const { return m_Settings; };
+	// Report of the last finished search that collected one
+	const SearchReport& GetReport() const { return m_Report; };
 private:
-	MCTSNode* m_RootNode;
+	std::vector<std::unique_ptr<SearchTree>> m_Trees{};
+	std::vector<SearchWorker> m_Workers{};
+	// Only used in ParallelMode::Leaf
+	std::unique_ptr<WorkerPool> m_pRolloutPool{};
+
+	void SetRoot(SearchTree& tree, const BitBoardState& state);
+	NodeIndex FindNode(const SearchTree& tree, const BitBoardState& state) const;
+	void PromoteToRoot(SearchTree& tree, NodeIndex newRoot, const BitBoardState& newRootState);
+
+	// Time and memory limits are only checked every so many iterations, reading the clock isn't free
+	static constexpr int LimitCheckInterval{ 32 };
+	// Searches without an iteration or node limit reserve room for this many new positions up front,
+	// a transposition table that fills up anyway is grown before the next search
+	static constexpr size_t MaxReservedPositions{ 1 << 20 };
+
+	void PrepareSearch(const BitBoardState& rootState, const SearchLimits& limits, bool collectReport);
+	void RunSearch();
+	void StartSearchThread(const GameState& pBoard, const SearchLimits& limits);
+	void Search(SearchTree& tree, SearchWorker& worker);
+	bool IsBudgetSpent() const;
+	// Takes up to LimitCheckInterval iterations from the budget the threads of a shared tree draw from, 0 once it's spent
+	int ClaimIterations();
+	int GetBestMove(const BitBoardState& rootState) const;
+	// A root proven by its children needs no more search, its best move is already known
+	bool IsRootProven(const SearchTree& tree) const;
+	void MakeReport();
+	NodeIndex SelectNode(SearchTree& tree, SearchWorker& worker, BitBoardState& state);
+	void Expand(SearchTree& tree, NodeIndex fromNode, const BitBoardState& state);
+	// Node of the position in the tree, or a new one if the position wasn't reached before, INVALID_NODE if the node arena is full
+	NodeIndex FindOrAddNode(SearchTree& tree, const BitBoardState& state, int lastMove);
+	RolloutResult Rollout(SearchTree& tree, SearchWorker& worker, NodeIndex node, const BitBoardState& state);
+	char Simulate(SearchTree& tree, SearchWorker& worker, NodeIndex node, BitBoardState& state);
+	void BackPropagate(SearchTree& tree, const SearchWorker& worker, const RolloutResult& result);
+	// Minimax over the proofs of the children, Unknown while it depends on a child that isn't proven
+	Proof GetProofFromChildren(const SearchTree& tree, NodeIndex node) const;
+	// Proves the nodes on the path above a newly proven node, as far up as the proof reaches
+	void PropagateProofs(SearchTree& tree, const SearchWorker& worker);
+	// Every rollout of a proven node ends the same way
+	RolloutResult GetProvenResult(const BitBoardState& state, Proof proof) const;
+
+	float CalculateUCB(const SearchTree& tree, const MCTSEdge& edge) const;
+	int GetRandomInt(SearchWorker& worker, int max) const;
 
-	MCTSNode* SelectNode(MCTSNode* fromNode);
-	void Expand(MCTSNode*& fromNode);
-	char Simulate(MCTSNode* node);
-	void BackPropagate(MCTSNode* fromNode, const char& winningPlayer);
+	// Limits of the running search, the first thread to run out of budget stops the others
+	SearchLimits m_Limits{};
+	std::chrono::steady_clock::time_point m_Deadline{};
+	std::atomic<bool> m_StopSearch{ false };
+	std::chrono::steady_clock::time_point m_SearchStart{};
+	// Iterations of all threads, counted in batches when the limits are checked
+	std::atomic<uint64_t> m_NrIterations{ 0 };
+	std::atomic<uint64_t> m_NrRollouts{ 0 };
+	// Iterations not yet claimed by the threads of a shared tree
+	std::atomic<int> m_NrIterationsLeft{ 0 };
+	bool m_CollectReport{ false };
+	uint32_t m_NrNodesAtStart{ 0 };
+	SearchReport m_Report{};
 
-	float CalculateUCB(const MCTSNode& node) const;
-	int m_NrIterations{ 10000 };
+	// Background search, used by the asynchronous API and for pondering
+	std::thread m_SearchThread{};
+	std::atomic<bool> m_SearchDone{ false };
+	bool m_IsPondering{ false };
 
+	MCTSSettings m_Settings;
 	Player* m_pPlayer;
-	StateAnalysis* m_pStateAnalysis;
+	Rules m_Rules;
 };
 
 
@@ -0,0 +1,24 @@
+#pragma once
+#include <array>
+#include <cassert>
+
+// Fixed capacity list of columns, stored inline so generating moves never touches the heap.
+// Mirrors the part of the std::vector interface the analysis and the search use.
+struct MoveList
+{
+	static constexpr int Capacity{ 7 };
+
+	void push_back(int move) { assert(Size < Capacity); Moves[Size++] = move; };
+	void append(const MoveList& other) { for (const int move : other) push_back(move); };
+	void clear() { Size = 0; };
+
+	int size() const { return Size; };
+	bool empty() const { return Size == 0; };
+	int operator[](int idx) const { return Moves[idx]; };
+
+	const int* begin() const { return Moves.data(); };
+	const int* end() const { return Moves.data() + Size; };
+
+	std::array<int, Capacity> Moves{};
+	int Size{ 0 };
+};
@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
+using NodeIndex = uint32_t;
+constexpr NodeIndex INVALID_NODE{ UINT32_MAX };
+
+// Hands out nodes from large contiguous blocks and refers to them by index.
+// Blocks are kept between searches, so Reset() is O(1) and a search in steady state doesn't allocate.
+// A range handed out by Allocate never straddles two blocks, so siblings can be stored next to each other.
+// Allocate may be called from several threads without locking: the next index is bumped atomically,
+// and a block is only installed (with a compare and swap) by the first range reaching into it.
+// Blocks never move, so nodes can be read while others allocate.
+template<typename Node>
+class NodeArena final
+{
+public:
+	static constexpr uint32_t BlockShift{ 16 };
+	static constexpr uint32_t BlockSize{ 1u << BlockShift };
+	static constexpr uint32_t MaxNrBlocks{ 4096 };
+	static constexpr uint32_t Capacity{ MaxNrBlocks * BlockSize };
+
+	NodeArena() = default;
+	~NodeArena()
+	{
+		for (std::atomic<Node*>& block : m_Blocks)
+			delete[] block.load(std::memory_order_relaxed);
+	}
+	NodeArena(const NodeArena& other) = delete;
+	NodeArena& operator=(const NodeArena& other) = delete;
+	NodeArena(NodeArena&& other) = delete;
+	NodeArena& operator=(NodeArena&& other) = delete;
+
+	// Returns the index of the first of nrNodes consecutive, default initialized nodes,
+	// or INVALID_NODE once the arena is full
+	NodeIndex Allocate(uint32_t nrNodes = 1)
+	{
+		assert(nrNodes > 0 && nrNodes <= BlockSize);
+
+		// Checked before bumping the index as well, so a full arena doesn't keep counting up until it wraps around
+		if (m_NextIndex.load(std::memory_order_relaxed) >= Capacity)
+			return INVALID_NODE;
+
+		// A range that would straddle two blocks is given up, the next one starts in the next block.
+		// Only the nodes at the end of a block are lost that way
+		NodeIndex first{ m_NextIndex.fetch_add(nrNodes, std::memory_order_relaxed) };
+		while ((first >> BlockShift) != ((first + nrNodes - 1) >> BlockShift))
+			first = m_NextIndex.fetch_add(nrNodes, std::memory_order_relaxed);
+
+		if (first + nrNodes > Capacity)
+			return INVALID_NODE;
+
+		Node* pBlock{ GetOrAddBlock(first >> BlockShift) };
+		const uint32_t offset{ first & (BlockSize - 1) };
+		for (uint32_t i{ 0 }; i < nrNodes; ++i)
+			pBlock[offset + i] = Node{};
+
+		m_NrAllocated.fetch_add(nrNodes, std::memory_order_relaxed);
+		return first;
+	}
+
+	// Not thread safe, only call when no search is running
+	void Reset() { m_NextIndex.store(0, std::memory_order_relaxed); m_NrAllocated.store(0, std::memory_order_relaxed); };
+	void Swap(NodeArena& other)
+	{
+		for (uint32_t block{ 0 }; block < MaxNrBlocks; ++block)
+			SwapValues(m_Blocks[block], other.m_Blocks[block]);
+		SwapValues(m_NrBlocks, other.m_NrBlocks);
+		SwapValues(m_NextIndex, other.m_NextIndex);
+		SwapValues(m_NrAllocated, other.m_NrAllocated);
+	}
+
+	Node& operator[](NodeIndex idx) { return m_Blocks[idx >> BlockShift].load(std::memory_order_acquire)[idx & (BlockSize - 1)]; };
+	const Node& operator[](NodeIndex idx) const { return m_Blocks[idx >> BlockShift].load(std::memory_order_acquire)[idx & (BlockSize - 1)]; };
+
+	// Can be read while other threads allocate
+	uint32_t GetNrAllocated() const { return m_NrAllocated.load(std::memory_order_relaxed); };
+	// Less than a block left, a search checking this every few iterations stops well before Allocate fails
+	bool IsNearlyFull() const { return m_NextIndex.load(std::memory_order_relaxed) >= Capacity - BlockSize; };
+	size_t GetReservedBytes() const { return m_NrBlocks.load(std::memory_order_relaxed) * BlockSize * sizeof(Node); };
+private:
+	Node* GetOrAddBlock(uint32_t block)
+	{
+		assert(block < MaxNrBlocks);
+		Node* pBlock{ m_Blocks[block].load(std::memory_order_acquire) };
+		if (pBlock != nullptr)
+			return pBlock;
+
+		// Several threads can reach a new block at once, the first one to install theirs wins
+		Node* pNewBlock{ new Node[BlockSize] };
+		if (m_Blocks[block].compare_exchange_strong(pBlock, pNewBlock, std::memory_order_acq_rel, std::memory_order_acquire))
+		{
+			m_NrBlocks.fetch_add(1, std::memory_order_relaxed);
+			return pNewBlock;
+		}
+
+		delete[] pNewBlock;
+		return pBlock;
+	}
+
+	template<typename T>
+	static void SwapValues(std::atomic<T>& a, std::atomic<T>& b)
+	{
+		const T value{ a.load(std::memory_order_relaxed) };
+		a.store(b.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		b.store(value, std::memory_order_relaxed);
+	}
+
+	std::array<std::atomic<Node*>, MaxNrBlocks> m_Blocks{};
+	std::atomic<uint32_t> m_NrBlocks{ 0 };
+	std::atomic<NodeIndex> m_NextIndex{ 0 };
+	std::atomic<uint32_t> m_NrAllocated{ 0 };
+};
@@ -1,15 +1,19 @@
 #include "pch.h"
 #include "Player.h"
+#include <algorithm>
 #include <iostream>
+#include <thread>
 #include "Board.h"
 #include "MonteCarloTreeSearch.h"
+#include "C4Analysis.h"
 
 Player::Player(const Color4f& color, bool isHuman, const std::string& name)
 	: m_Color{ color }
 	, m_IsHuman{ isHuman }
 	, m_Name{ name }
-	, m_pMCTS{ new MonteCarloTreeSearch(this) }
+	, m_pMCTS{ nullptr }
 {
+	Reset();
 }
 
 Player::~Player()
@@ -20,7 +24,14 @@ Player::~Player()
 
 bool Player::GetMove(const Board& pBoard, int& i)
 {
-	if (!m_WaitingForMove) m_WaitingForMove = true;
+	if (!m_WaitingForMove)
+	{
+		m_WaitingForMove = true;
+
+		// Search in the background so the window keeps rendering while the MCTS thinks
+		if (!m_IsHuman)
+			m_pMCTS->StartSearch(pBoard);
+	}
 
 	if (m_IsHuman)
 	{
@@ -42,13 +53,29 @@ bool Player::GetMove(const Board& pBoard, int& i)
 	}
 	else {
 		//Monte Carlo Tree Search
-		i = m_pMCTS->FindNextMove(pBoard);
-		return true;
+		if (m_pMCTS->IsSearchDone())
+		{
+			i = m_pMCTS->GetSearchResult();
+			m_WaitingForMove = false;
+			return true;
+		}
 	}
 
 	return false;
 }
 
+void Player::Ponder(const Board& pBoard)
+{
+	if (!m_IsHuman)
+		m_pMCTS->StartPondering(pBoard);
+}
+
+void Player::StopPondering()
+{
+	if (!m_IsHuman)
+		m_pMCTS->StopPondering();
+}
+
 void Player::ProcessMouseDownEvent(const SDL_MouseButtonEvent& e)
 {
 	if (!m_WaitingForMove)
@@ -73,6 +100,10 @@ void Player::Reset()
 	delete m_pMCTS;
 	m_pMCTS = nullptr;
 
-	m_pMCTS = new MonteCarloTreeSearch(this);
+	// Search one tree per core
+	MCTSSettings settings{};
+	settings.NrThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	m_pMCTS = new MonteCarloTreeSearch<C4_Analysis>(this, settings);
 	m_WaitingForMove = false;
 }
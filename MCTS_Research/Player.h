@@ -3,7 +3,8 @@
 
 // Forward Declarations
 class Board;
-class MonteCarloTreeSearch;
+template<typename Rules> class MonteCarloTreeSearch;
+struct C4_Analysis;
 
 class Player {
 public:
@@ -15,10 +16,14 @@ public:
 	bool IsHuman() const { return m_IsHuman; };
 
 	// Gets the player's next move. (Input if human, otherwise MCTS)
+	// Returns false while the move isn't known yet, the MCTS searches in the background in the meantime
 	bool GetMove(const Board& pBoard, int& i);
+	// Lets the MCTS keep searching while the opponent decides on their move
+	void Ponder(const Board& pBoard);
+	void StopPondering();
 
 	void ProcessMouseDownEvent(const SDL_MouseButtonEvent& e);
-	MonteCarloTreeSearch* GetMCTS() const { return m_pMCTS; };
+	MonteCarloTreeSearch<C4_Analysis>* GetMCTS() const { return m_pMCTS; };
 	void Reset();
 	char GetInitial() const { return m_Name[0]; };
 private:
@@ -29,5 +34,5 @@ private:
 	bool m_WaitingForMove{ false };
 	Vector2f m_ClickPos{INVALID_POSITION};
 
-	MonteCarloTreeSearch* m_pMCTS;
+	MonteCarloTreeSearch<C4_Analysis>* m_pMCTS;
 };
@@ -0,0 +1,124 @@
+#include "pch.h"
+#include "Profiler.h"
+
+#ifdef MCTS_PROFILING
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	const std::array<const char*, NrProfileZones> g_ZoneNames{
+		"Select", "Expand", "Simulate", "BackPropagate", "GetAvailableActions", "CheckWin", "CheckDraw", "Solve"
+	};
+
+	// Counters of the running threads, and what the threads that exited had counted
+	struct Registry
+	{
+		std::mutex Mutex{};
+		std::vector<Profiler::ThreadCounters*> Threads{};
+		std::array<uint64_t, NrProfileZones> ExitedTicks{};
+		std::array<uint64_t, NrProfileZones> ExitedNrCalls{};
+	};
+
+	Registry& GetRegistry()
+	{
+		// Never destroyed, threads can still exit while static objects are destroyed
+		static Registry* pRegistry{ new Registry{} };
+		return *pRegistry;
+	}
+
+	// The clock ticks are calibrated against steady_clock over the lifetime of the program
+	const uint64_t g_StartTicks{ Profiler::ReadClock() };
+	const std::chrono::steady_clock::time_point g_StartTime{ std::chrono::steady_clock::now() };
+
+	double GetTicksPerSecond()
+	{
+		const double seconds{ std::chrono::duration<double>(std::chrono::steady_clock::now() - g_StartTime).count() };
+		const uint64_t ticks{ Profiler::ReadClock() - g_StartTicks };
+		return seconds > 0.0 ? static_cast<double>(ticks) / seconds : 1.0;
+	}
+}
+
+Profiler::ThreadCounters::ThreadCounters()
+{
+	Registry& registry{ GetRegistry() };
+	std::lock_guard<std::mutex> lock{ registry.Mutex };
+	registry.Threads.push_back(this);
+}
+
+Profiler::ThreadCounters::~ThreadCounters()
+{
+	Registry& registry{ GetRegistry() };
+	std::lock_guard<std::mutex> lock{ registry.Mutex };
+	for (int zone{ 0 }; zone < NrProfileZones; ++zone)
+	{
+		registry.ExitedTicks[zone] += Ticks[zone].load(std::memory_order_relaxed);
+		registry.ExitedNrCalls[zone] += NrCalls[zone].load(std::memory_order_relaxed);
+	}
+	registry.Threads.erase(std::find(registry.Threads.begin(), registry.Threads.end(), this));
+}
+
+std::array<Profiler::ZoneTotal, NrProfileZones> Profiler::Collect()
+{
+	Registry& registry{ GetRegistry() };
+	std::lock_guard<std::mutex> lock{ registry.Mutex };
+
+	std::array<uint64_t, NrProfileZones> ticks{ registry.ExitedTicks };
+	std::array<uint64_t, NrProfileZones> nr_calls{ registry.ExitedNrCalls };
+	for (const ThreadCounters* pCounters : registry.Threads)
+	{
+		for (int zone{ 0 }; zone < NrProfileZones; ++zone)
+		{
+			ticks[zone] += pCounters->Ticks[zone].load(std::memory_order_relaxed);
+			nr_calls[zone] += pCounters->NrCalls[zone].load(std::memory_order_relaxed);
+		}
+	}
+
+	const double ticks_per_second{ GetTicksPerSecond() };
+	std::array<ZoneTotal, NrProfileZones> totals{};
+	for (int zone{ 0 }; zone < NrProfileZones; ++zone)
+	{
+		totals[zone].NrCalls = nr_calls[zone];
+		totals[zone].Seconds = static_cast<double>(ticks[zone]) / ticks_per_second;
+	}
+	return totals;
+}
+
+void Profiler::Reset()
+{
+	Registry& registry{ GetRegistry() };
+	std::lock_guard<std::mutex> lock{ registry.Mutex };
+
+	registry.ExitedTicks = {};
+	registry.ExitedNrCalls = {};
+	for (ThreadCounters* pCounters : registry.Threads)
+	{
+		for (int zone{ 0 }; zone < NrProfileZones; ++zone)
+		{
+			pCounters->Ticks[zone].store(0, std::memory_order_relaxed);
+			pCounters->NrCalls[zone].store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+std::string Profiler::Report()
+{
+	const std::array<ZoneTotal, NrProfileZones> totals{ Collect() };
+
+	std::ostringstream report{};
+	report << std::left << std::setw(22) << "Zone" << std::right << std::setw(14) << "Calls"
+		<< std::setw(12) << "Total(ms)" << std::setw(12) << "ns/call" << '\n';
+	for (int zone{ 0 }; zone < NrProfileZones; ++zone)
+	{
+		const ZoneTotal& total{ totals[zone] };
+		report << std::left << std::setw(22) << g_ZoneNames[zone] << std::right << std::setw(14) << total.NrCalls
+			<< std::fixed << std::setprecision(1) << std::setw(12) << total.Seconds * 1000.0
+			<< std::setw(12) << (total.NrCalls > 0 ? total.Seconds * 1e9 / static_cast<double>(total.NrCalls) : 0.0) << '\n';
+	}
+	return report.str();
+}
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Scoped timers for the hot paths of the search, compiled in when MCTS_PROFILING is defined.
+// Without it MCTS_PROFILE_SCOPE expands to nothing, so release builds don't pay anything for them.
+// Zones can nest, the time of a zone includes the zones inside it (e.g. CheckWin inside Simulate).
+enum class ProfileZone
+{
+	Select,
+	Expand,
+	Simulate,
+	BackPropagate,
+	GetAvailableActions,
+	CheckWin,
+	CheckDraw,
+	Solve
+};
+constexpr int NrProfileZones{ 8 };
+
+#ifdef MCTS_PROFILING
+#include <atomic>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace Profiler
+{
+	// The time stamp counter where there is one, it only takes a few cycles to read.
+	// Ticks are converted to seconds when the totals are collected
+	inline uint64_t ReadClock()
+	{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+	}
+
+	// Counters of one thread. Only that thread writes them, so adding needs no atomic read-modify-write,
+	// the atomics are only there so Collect can read them while the thread runs
+	struct ThreadCounters
+	{
+		ThreadCounters();
+		~ThreadCounters();
+		ThreadCounters(const ThreadCounters& other) = delete;
+		ThreadCounters& operator=(const ThreadCounters& other) = delete;
+
+		void Add(ProfileZone zone, uint64_t ticks)
+		{
+			const int idx{ static_cast<int>(zone) };
+			Ticks[idx].store(Ticks[idx].load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+			NrCalls[idx].store(NrCalls[idx].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+
+		std::array<std::atomic<uint64_t>, NrProfileZones> Ticks{};
+		std::array<std::atomic<uint64_t>, NrProfileZones> NrCalls{};
+	};
+
+	inline thread_local ThreadCounters t_Counters{};
+
+	class ScopedTimer final
+	{
+	public:
+		explicit ScopedTimer(ProfileZone zone) : m_Zone{ zone }, m_Start{ ReadClock() } {};
+		~ScopedTimer() { t_Counters.Add(m_Zone, ReadClock() - m_Start); };
+
+		ScopedTimer(const ScopedTimer& other) = delete;
+		ScopedTimer& operator=(const ScopedTimer& other) = delete;
+	private:
+		ProfileZone m_Zone;
+		uint64_t m_Start;
+	};
+
+	struct ZoneTotal
+	{
+		uint64_t NrCalls{ 0 };
+		double Seconds{ 0.0 };
+	};
+
+	// Totals of all threads, the ones that already exited included
+	std::array<ZoneTotal, NrProfileZones> Collect();
+	// Only call when no search is running, a thread adding meanwhile can undo the reset of its counters
+	void Reset();
+	// Calls, total time and time per call of every zone, one zone per line
+	std::string Report();
+}
+
+#define MCTS_PROFILE_CONCAT_INNER(a, b) a##b
+#define MCTS_PROFILE_CONCAT(a, b) MCTS_PROFILE_CONCAT_INNER(a, b)
+#define MCTS_PROFILE_SCOPE(zone) const Profiler::ScopedTimer MCTS_PROFILE_CONCAT(profile_timer_, __LINE__){ zone }
+#else
+#define MCTS_PROFILE_SCOPE(zone)
+#endif
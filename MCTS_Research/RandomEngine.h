@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+// xoshiro256** by Blackman and Vigna, small and fast enough to be called on every ply of a rollout.
+// Not thread safe on purpose, every search thread owns one.
+class RandomEngine final
+{
+public:
+	explicit RandomEngine(uint64_t seed = 0) { Seed(seed); };
+
+	// The state is filled with splitmix64, so close seeds (e.g. seed + thread index) still give unrelated streams
+	void Seed(uint64_t seed)
+	{
+		for (uint64_t& word : m_State)
+		{
+			seed += 0x9E3779B97F4A7C15ull;
+			uint64_t z{ seed };
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			word = z ^ (z >> 31);
+		}
+	}
+
+	uint64_t Next()
+	{
+		const uint64_t result{ RotateLeft(m_State[1] * 5, 7) * 9 };
+		const uint64_t t{ m_State[1] << 17 };
+
+		m_State[2] ^= m_State[0];
+		m_State[3] ^= m_State[1];
+		m_State[1] ^= m_State[2];
+		m_State[0] ^= m_State[3];
+		m_State[2] ^= t;
+		m_State[3] = RotateLeft(m_State[3], 45);
+
+		return result;
+	}
+
+	// Uniform number in [0, max), without the modulo bias of rand() % max (Lemire's multiply and reject)
+	uint32_t NextBelow(uint32_t max)
+	{
+		uint64_t product{ (Next() >> 32) * max };
+		uint32_t low{ static_cast<uint32_t>(product) };
+		if (low < max)
+		{
+			const uint32_t threshold{ (0u - max) % max };
+			while (low < threshold)
+			{
+				product = (Next() >> 32) * max;
+				low = static_cast<uint32_t>(product);
+			}
+		}
+		return static_cast<uint32_t>(product >> 32);
+	}
+private:
+	static uint64_t RotateLeft(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); };
+
+	uint64_t m_State[4]{};
+};
@@ -0,0 +1,70 @@
+#include "pch.h"
+#include "SearchReport.h"
+#include <iomanip>
+#include <sstream>
+
+namespace
+{
+	const std::array<const char*, NrSearchPhases> g_PhaseNames{ "select", "expand", "simulate", "backpropagate" };
+
+	long long ToMicroseconds(std::chrono::nanoseconds time)
+	{
+		return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(time).count());
+	}
+}
+
+std::string SearchReport::ToJson() const
+{
+	std::ostringstream json{};
+	json << std::fixed << std::setprecision(2)
+		<< "{\"iterations\":" << NrIterations
+		<< ",\"rollouts\":" << NrRollouts
+		<< ",\"time_us\":" << Time.count()
+		<< ",\"new_nodes\":" << NrNewNodes
+		<< ",\"nodes\":" << NrNodes
+		<< ",\"max_depth\":" << MaxDepth
+		<< ",\"avg_depth\":" << AverageDepth
+		<< ",\"best_move\":" << BestMove
+		<< ",\"solved_leaves\":" << NrSolvedLeaves;
+
+	json << ",\"phase_us\":{";
+	for (int phase{ 0 }; phase < NrSearchPhases; ++phase)
+		json << (phase > 0 ? "," : "") << '"' << g_PhaseNames[phase] << "\":" << ToMicroseconds(PhaseTimes[phase]);
+
+	json << "},\"root_children\":[";
+	for (size_t i{ 0 }; i < RootChildren.size(); ++i)
+	{
+		const RootChild& child{ RootChildren[i] };
+		json << (i > 0 ? "," : "") << "{\"move\":" << child.Move << ",\"visits\":" << child.NrVisits << ",\"wins\":" << child.NrWins << '}';
+	}
+	json << "]}";
+
+	return json.str();
+}
+
+std::string SearchReport::ToCsv() const
+{
+	std::ostringstream csv{};
+	csv << std::fixed << std::setprecision(2)
+		<< NrIterations << ',' << NrRollouts << ',' << Time.count() << ',' << NrNewNodes << ',' << NrNodes << ','
+		<< MaxDepth << ',' << AverageDepth << ',' << BestMove << ',' << NrSolvedLeaves;
+
+	for (const std::chrono::nanoseconds time : PhaseTimes)
+		csv << ',' << ToMicroseconds(time);
+
+	// The root children share one column as move:visits:wins, separated by spaces
+	csv << ',';
+	for (size_t i{ 0 }; i < RootChildren.size(); ++i)
+		csv << (i > 0 ? " " : "") << RootChildren[i].Move << ':' << RootChildren[i].NrVisits << ':' << RootChildren[i].NrWins;
+
+	return csv.str();
+}
+
+std::string SearchReport::GetCsvHeader()
+{
+	std::string header{ "iterations,rollouts,time_us,new_nodes,nodes,max_depth,avg_depth,best_move,solved_leaves" };
+	for (const char* phase_name : g_PhaseNames)
+		header += std::string{ "," } + phase_name + "_us";
+
+	return header + ",root_children";
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The four steps of every search iteration
+enum class SearchPhase
+{
+	Select,
+	Expand,
+	Simulate,
+	BackPropagate
+};
+constexpr int NrSearchPhases{ 4 };
+
+// What a search did and where its time went, see MCTSSettings::CollectReport
+struct SearchReport
+{
+	struct RootChild
+	{
+		int Move{ INVALID_INDEX };
+		uint64_t NrVisits{ 0 };
+		// Wins of the player to move in the root
+		uint64_t NrWins{ 0 };
+	};
+
+	uint64_t NrIterations{ 0 };
+	// Rollouts actually played, leaves that are proven or solved don't need any
+	uint64_t NrRollouts{ 0 };
+	std::chrono::microseconds Time{ 0 };
+	// Nodes made by this search, and all nodes including the ones kept from the previous search
+	uint32_t NrNewNodes{ 0 };
+	uint32_t NrNodes{ 0 };
+	// Depth of the node every iteration simulated from, the root being depth 0
+	int MaxDepth{ 0 };
+	float AverageDepth{ 0.0f };
+	int BestMove{ INVALID_INDEX };
+	// Leaves the endgame solver settled instead of rollouts
+	uint64_t NrSolvedLeaves{ 0 };
+	// Merged over the trees of all threads
+	std::vector<RootChild> RootChildren{};
+	// Summed over all searching threads, so with several threads they add up to more than Time
+	std::array<std::chrono::nanoseconds, NrSearchPhases> PhaseTimes{};
+
+	// One line each, so the reports of many searches can be appended to one file
+	std::string ToJson() const;
+	std::string ToCsv() const;
+	static std::string GetCsvHeader();
+};
@@ -1,14 +1,38 @@
 #pragma once
-#include <vector>
+#include "MoveList.h"
 
 class GameState;
+class BitBoardState;
 
 struct StateAnalysis
 {
-	virtual std::vector<int> GetAvailableActions(const GameState& state) const = 0;
+	virtual MoveList GetAvailableActions(const GameState& state) const = 0;
 	virtual bool CheckWin(const GameState& state, const char& player) const = 0;
+	// Only looks at the lines through the top piece of the column, i.e. the piece that was just played
+	virtual bool CheckWinAfterMove(const GameState& state, int column) const = 0;
 	virtual bool CheckDraw(const GameState& state) const = 0;
 	virtual bool InProgress(const GameState& state) const = 0;
+
+	virtual MoveList GetAvailableActions(const BitBoardState& state) const = 0;
+	virtual bool CheckWin(const BitBoardState& state, const char& player) const = 0;
+	virtual bool CheckWinAfterMove(const BitBoardState& state, int column) const = 0;
+	virtual bool CheckDraw(const BitBoardState& state) const = 0;
+	virtual bool InProgress(const BitBoardState& state) const = 0;
+
 	virtual float EvaluatePosition(const GameState& state, const char& forPlayer, const char& againstPlayer) const = 0;
 };
 
+// Rules policy for MonteCarloTreeSearch that forwards to a StateAnalysis chosen at runtime.
+// Every call stays virtual, use the concrete analysis as policy when the rules are known at compile time.
+struct StateAnalysisRules final
+{
+	explicit StateAnalysisRules(const StateAnalysis& analysis) : pAnalysis{ &analysis } {};
+
+	MoveList GetAvailableActions(const BitBoardState& state) const { return pAnalysis->GetAvailableActions(state); };
+	bool CheckWin(const BitBoardState& state, const char& player) const { return pAnalysis->CheckWin(state, player); };
+	bool CheckWinAfterMove(const BitBoardState& state, int column) const { return pAnalysis->CheckWinAfterMove(state, column); };
+	bool CheckDraw(const BitBoardState& state) const { return pAnalysis->CheckDraw(state); };
+	bool InProgress(const BitBoardState& state) const { return pAnalysis->InProgress(state); };
+
+	const StateAnalysis* pAnalysis;
+};
@@ -0,0 +1,71 @@
+#include "pch.h"
+#include "TranspositionTable.h"
+#include <algorithm>
+#include <utility>
+
+void TranspositionTable::Reserve(size_t nrEntries)
+{
+	size_t size{ std::max(m_Size, InitialSize) };
+	while (nrEntries * 2 > size)
+		size *= 2;
+
+	if (size != m_Size)
+		Rehash(size);
+}
+
+void TranspositionTable::Clear()
+{
+	// A search that filled the table gets a bigger one next time
+	const size_t nr_needed{ GetNrEntries() + m_NrMissed.load(std::memory_order_relaxed) };
+	m_NrEntries.store(0, std::memory_order_relaxed);
+	m_NrMissed.store(0, std::memory_order_relaxed);
+
+	// Keep the memory for the next search, only wipe it when the generation wraps around
+	if (++m_Generation == MaxGeneration)
+	{
+		for (size_t slot{ 0 }; slot < m_Size; ++slot)
+			m_Entries[slot].Tag.store(0, std::memory_order_relaxed);
+		m_Generation = 1;
+	}
+
+	Reserve(nr_needed);
+}
+
+void TranspositionTable::Swap(TranspositionTable& other)
+{
+	m_Entries.swap(other.m_Entries);
+	std::swap(m_Size, other.m_Size);
+	const size_t nr_entries{ GetNrEntries() };
+	m_NrEntries.store(other.GetNrEntries(), std::memory_order_relaxed);
+	other.m_NrEntries.store(nr_entries, std::memory_order_relaxed);
+	const size_t nr_missed{ m_NrMissed.load(std::memory_order_relaxed) };
+	m_NrMissed.store(other.m_NrMissed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	other.m_NrMissed.store(nr_missed, std::memory_order_relaxed);
+	std::swap(m_Generation, other.m_Generation);
+}
+
+void TranspositionTable::Rehash(size_t size)
+{
+	// The size is a power of two, entries of the current generation move to their slot in the new table
+	std::unique_ptr<Entry[]> old_entries{ std::make_unique<Entry[]>(size) };
+	old_entries.swap(m_Entries);
+	const size_t old_size{ std::exchange(m_Size, size) };
+
+	const uint32_t ready_tag{ (m_Generation << 1) | 1 };
+	const size_t mask{ m_Size - 1 };
+	for (size_t old_slot{ 0 }; old_slot < old_size; ++old_slot)
+	{
+		const Entry& old_entry{ old_entries[old_slot] };
+		if (old_entry.Tag.load(std::memory_order_relaxed) != ready_tag)
+			continue;
+
+		const uint64_t hash{ old_entry.Hash.load(std::memory_order_relaxed) };
+		size_t slot{ static_cast<size_t>(hash) & mask };
+		while (m_Entries[slot].Tag.load(std::memory_order_relaxed) == ready_tag)
+			slot = (slot + 1) & mask;
+
+		m_Entries[slot].Hash.store(hash, std::memory_order_relaxed);
+		m_Entries[slot].Node.store(old_entry.Node.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		m_Entries[slot].Tag.store(ready_tag, std::memory_order_relaxed);
+	}
+}
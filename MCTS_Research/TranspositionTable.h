@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include "NodeArena.h"
+
+// Maps position hashes to the search node of that position, so every position is stored once
+// no matter in which order its moves were played. Open addressing with linear probing.
+// Search threads claim empty slots with a compare and swap, so FindOrAdd never locks.
+// The table can't grow while it is shared: Reserve makes room before a search, and once the table is
+// three quarters full new positions are no longer shared until the next search gets a bigger table.
+class TranspositionTable final
+{
+public:
+	TranspositionTable() = default;
+	TranspositionTable(const TranspositionTable& other) = delete;
+	TranspositionTable& operator=(const TranspositionTable& other) = delete;
+	TranspositionTable(TranspositionTable&& other) = delete;
+	TranspositionTable& operator=(TranspositionTable&& other) = delete;
+
+	// Returns the node of the position, addNode() is called to make one if the position isn't in the table yet.
+	// When addNode() fails and returns INVALID_NODE, that is what the position maps to for the rest of the generation.
+	// A thread that finds the position while another one is adding it waits for its node, so two threads never add the same position
+	template<typename AddNode>
+	NodeIndex FindOrAdd(uint64_t hash, AddNode addNode)
+	{
+		assert(m_Size > 0);
+		const uint32_t claimed_tag{ m_Generation << 1 };
+		const uint32_t ready_tag{ claimed_tag | 1 };
+		const bool is_full{ m_NrEntries.load(std::memory_order_relaxed) >= GetMaxNrEntries() };
+
+		const size_t mask{ m_Size - 1 };
+		for (size_t slot{ static_cast<size_t>(hash) & mask }; ; slot = (slot + 1) & mask)
+		{
+			Entry& entry{ m_Entries[slot] };
+			uint32_t tag{ entry.Tag.load(std::memory_order_acquire) };
+
+			// Slots of older generations are empty, the position isn't in the table
+			if (tag >> 1 != m_Generation)
+			{
+				if (is_full)
+					break;
+
+				if (entry.Tag.compare_exchange_strong(tag, claimed_tag, std::memory_order_acquire, std::memory_order_acquire))
+				{
+					entry.Node.store(PendingNode, std::memory_order_relaxed);
+					entry.Hash.store(hash, std::memory_order_relaxed);
+					entry.Tag.store(ready_tag, std::memory_order_release);
+					m_NrEntries.fetch_add(1, std::memory_order_relaxed);
+
+					const NodeIndex node{ addNode() };
+					entry.Node.store(node, std::memory_order_release);
+					return node;
+				}
+				// Another thread claimed the slot first, tag now holds its claim
+			}
+
+			while (tag == claimed_tag)
+			{
+				std::this_thread::yield();
+				tag = entry.Tag.load(std::memory_order_acquire);
+			}
+
+			if (entry.Hash.load(std::memory_order_relaxed) == hash)
+			{
+				NodeIndex node{ entry.Node.load(std::memory_order_acquire) };
+				while (node == PendingNode)
+				{
+					std::this_thread::yield();
+					node = entry.Node.load(std::memory_order_acquire);
+				}
+				return node;
+			}
+		}
+
+		m_NrMissed.fetch_add(1, std::memory_order_relaxed);
+		return addNode();
+	}
+	NodeIndex FindOrInsert(uint64_t hash, NodeIndex node) { return FindOrAdd(hash, [node]() { return node; }); };
+
+	// The functions below aren't thread safe, only call them when no search is running
+
+	// Makes room for nrEntries positions without the table getting more than half full
+	void Reserve(size_t nrEntries);
+	// O(1), entries of older generations count as empty. Grows the table if the last search outgrew it
+	void Clear();
+	void Swap(TranspositionTable& other);
+
+	size_t GetNrEntries() const { return m_NrEntries.load(std::memory_order_relaxed); };
+	size_t GetReservedBytes() const { return m_Size * sizeof(Entry); };
+private:
+	struct Entry
+	{
+		std::atomic<uint64_t> Hash{ 0 };
+		// Generation of the entry shifted left by one, the lowest bit is set once Hash is written
+		std::atomic<uint32_t> Tag{ 0 };
+		// PendingNode while the thread that claimed the slot is still adding the node
+		std::atomic<NodeIndex> Node{ INVALID_NODE };
+	};
+
+	static constexpr NodeIndex PendingNode{ INVALID_NODE - 1 };
+
+	static constexpr size_t InitialSize{ 1 << 16 };
+	// The generation has to fit in the tag next to the ready bit
+	static constexpr uint32_t MaxGeneration{ UINT32_MAX >> 1 };
+
+	size_t GetMaxNrEntries() const { return m_Size / 4 * 3; };
+	void Rehash(size_t size);
+
+	std::unique_ptr<Entry[]> m_Entries{};
+	size_t m_Size{ 0 };
+	std::atomic<size_t> m_NrEntries{ 0 };
+	// Positions that weren't added because the table was full
+	std::atomic<size_t> m_NrMissed{ 0 };
+	uint32_t m_Generation{ 1 };
+};
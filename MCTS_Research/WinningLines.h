@@ -0,0 +1,113 @@
+#pragma once
+#include "BitBoardState.h"
+#include <array>
+#include <cstdint>
+
+// The 69 lines of four cells a Connect 4 game can be won on, and for every cell the lines through it.
+// Lines are masks in the bitboard layout of BitBoardState, so how many pieces a player has on a line is one popcount.
+// Both tables are generated at compile time.
+namespace WinningLines
+{
+	constexpr int NrRows{ BitBoardState::NrRows };
+	constexpr int NrColumns{ BitBoardState::NrColumns };
+	// 24 horizontal, 21 vertical and 12 along each diagonal
+	constexpr int NrLines{ 69 };
+	// The four cells in the middle rows of the middle column each lie on 13 lines
+	constexpr int MaxLinesPerCell{ 13 };
+
+	enum class Orientation { Horizontal, Vertical, Ascending, Descending };
+	constexpr int NrOrientations{ 4 };
+
+	struct Cell
+	{
+		uint8_t Row;
+		uint8_t Column;
+	};
+
+	struct Line
+	{
+		uint64_t Mask;
+		std::array<Cell, 4> Cells;
+		Orientation Direction;
+	};
+
+	// Indices into Lines of the lines through one cell
+	struct CellLines
+	{
+		const uint8_t* begin() const { return Indices.data(); };
+		const uint8_t* end() const { return Indices.data() + Size; };
+
+		std::array<uint8_t, MaxLinesPerCell> Indices;
+		int Size;
+	};
+
+	constexpr std::array<Line, NrLines> GenerateLines()
+	{
+		// Step from one cell of a line to the next, per orientation
+		constexpr int row_steps[NrOrientations]{ 0, 1, 1, 1 };
+		constexpr int column_steps[NrOrientations]{ 1, 0, 1, -1 };
+
+		std::array<Line, NrLines> lines{};
+		int nr_lines{ 0 };
+		for (int orientation{ 0 }; orientation < NrOrientations; ++orientation)
+		{
+			for (int row{ 0 }; row < NrRows; ++row)
+			{
+				for (int column{ 0 }; column < NrColumns; ++column)
+				{
+					const int last_row{ row + 3 * row_steps[orientation] };
+					const int last_column{ column + 3 * column_steps[orientation] };
+					if (last_row >= NrRows || last_column < 0 || last_column >= NrColumns)
+						continue;
+
+					Line& line{ lines[nr_lines++] };
+					line.Direction = static_cast<Orientation>(orientation);
+					for (int i{ 0 }; i < 4; ++i)
+					{
+						const int cell_row{ row + i * row_steps[orientation] };
+						const int cell_column{ column + i * column_steps[orientation] };
+						line.Cells[i] = Cell{ static_cast<uint8_t>(cell_row), static_cast<uint8_t>(cell_column) };
+						line.Mask |= BitBoardState::CellMask(cell_row, cell_column);
+					}
+				}
+			}
+		}
+		return lines;
+	}
+
+	inline constexpr std::array<Line, NrLines> Lines{ GenerateLines() };
+
+	constexpr std::array<CellLines, NrRows * NrColumns> GenerateCellLines()
+	{
+		std::array<CellLines, NrRows * NrColumns> cell_lines{};
+		for (int line{ 0 }; line < NrLines; ++line)
+		{
+			for (const Cell& cell : Lines[line].Cells)
+			{
+				CellLines& lines_through{ cell_lines[cell.Row * NrColumns + cell.Column] };
+				lines_through.Indices[lines_through.Size++] = static_cast<uint8_t>(line);
+			}
+		}
+		return cell_lines;
+	}
+
+	inline constexpr std::array<CellLines, NrRows * NrColumns> LinesThroughCell{ GenerateCellLines() };
+
+	constexpr const CellLines& GetLinesThrough(int row, int column) { return LinesThroughCell[row * NrColumns + column]; }
+
+	constexpr uint64_t GenerateBottomRow()
+	{
+		uint64_t bottom_row{ 0 };
+		for (int column{ 0 }; column < NrColumns; ++column)
+			bottom_row |= BitBoardState::BottomMask(column);
+		return bottom_row;
+	}
+
+	inline constexpr uint64_t BottomRow{ GenerateBottomRow() };
+	// Every cell of the board, without the sentinel bit on top of each column
+	inline constexpr uint64_t BoardCells{ BottomRow * ((uint64_t{ 1 } << NrRows) - 1) };
+
+	// The empty cells a piece can be dropped on: adding the bottom row to the pieces carries into the lowest empty
+	// cell of every column, full columns carry into their sentinel bit which is masked away
+	constexpr uint64_t GetPlayableCells(uint64_t mask) { return (mask + BottomRow) & BoardCells; }
+}
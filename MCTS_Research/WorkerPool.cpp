@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int nrThreads)
+{
+	for (int i{ 1 }; i < nrThreads; ++i)
+		m_Threads.emplace_back([this, i]() { WorkLoop(i); });
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_IsQuitting = true;
+	}
+	m_WorkCondition.notify_all();
+
+	for (std::thread& thread : m_Threads)
+		thread.join();
+}
+
+void WorkerPool::Run(int nrJobs, const Job& job)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_pJob = &job;
+		m_NrJobs = nrJobs;
+		m_NextJob.store(0, std::memory_order_relaxed);
+		m_NrBusyThreads = static_cast<int>(m_Threads.size());
+		++m_Batch;
+	}
+	m_WorkCondition.notify_all();
+
+	// Take jobs on this thread too instead of only waiting
+	RunJobs(0);
+
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	m_DoneCondition.wait(lock, [this]() { return m_NrBusyThreads == 0; });
+	m_pJob = nullptr;
+}
+
+void WorkerPool::WorkLoop(int threadIdx)
+{
+	uint64_t last_batch{ 0 };
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock{ m_Mutex };
+			m_WorkCondition.wait(lock, [this, last_batch]() { return m_IsQuitting || m_Batch != last_batch; });
+			if (m_IsQuitting)
+				return;
+
+			last_batch = m_Batch;
+		}
+
+		RunJobs(threadIdx);
+
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		if (--m_NrBusyThreads == 0)
+			m_DoneCondition.notify_one();
+	}
+}
+
+void WorkerPool::RunJobs(int threadIdx)
+{
+	// Jobs are handed out one by one, so a thread that finishes early takes the next one
+	for (int job{ m_NextJob.fetch_add(1, std::memory_order_relaxed) }; job < m_NrJobs; job = m_NextJob.fetch_add(1, std::memory_order_relaxed))
+		(*m_pJob)(threadIdx, job);
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Keeps a few threads alive so small batches of jobs can be spread over them
+// without paying for starting a thread every time.
+class WorkerPool final
+{
+public:
+	// Called with the index of the thread running it (0 is the calling thread) and the index of the job
+	using Job = std::function<void(int threadIdx, int jobIdx)>;
+
+	// nrThreads includes the calling thread, which helps out while it waits
+	explicit WorkerPool(int nrThreads);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool& other) = delete;
+	WorkerPool& operator=(const WorkerPool& other) = delete;
+	WorkerPool(WorkerPool&& other) = delete;
+	WorkerPool& operator=(WorkerPool&& other) = delete;
+
+	// Runs job for every index in [0, nrJobs) and returns once all of them are done
+	void Run(int nrJobs, const Job& job);
+
+	int GetNrThreads() const { return static_cast<int>(m_Threads.size()) + 1; };
+private:
+	void WorkLoop(int threadIdx);
+	void RunJobs(int threadIdx);
+
+	std::vector<std::thread> m_Threads{};
+	std::mutex m_Mutex{};
+	std::condition_variable m_WorkCondition{};
+	std::condition_variable m_DoneCondition{};
+
+	const Job* m_pJob{ nullptr };
+	int m_NrJobs{ 0 };
+	std::atomic<int> m_NextJob{ 0 };
+	int m_NrBusyThreads{ 0 };
+	// Bumped for every batch, so waiting threads know there is new work
+	uint64_t m_Batch{ 0 };
+	bool m_IsQuitting{ false };
+};
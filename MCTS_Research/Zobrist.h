@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+// Zobrist hashing for Connect 4 positions: one random key per player and cell.
+// The hash of a position is the xor of the keys of all its pieces, so placing a piece updates it with a single xor.
+namespace Zobrist
+{
+	constexpr int NrRows{ 6 };
+	constexpr int NrColumns{ 7 };
+
+	// Keys are generated at compile time with splitmix64, the same keys in every build
+	constexpr std::array<std::array<uint64_t, NrRows * NrColumns>, 2> GenerateKeys()
+	{
+		std::array<std::array<uint64_t, NrRows * NrColumns>, 2> keys{};
+		uint64_t seed{ 0x5A0B1C2D3E4F6071ull };
+		for (auto& player_keys : keys)
+		{
+			for (uint64_t& key : player_keys)
+			{
+				seed += 0x9E3779B97F4A7C15ull;
+				uint64_t z{ seed };
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+				key = z ^ (z >> 31);
+			}
+		}
+		return keys;
+	}
+
+	inline constexpr std::array<std::array<uint64_t, NrRows * NrColumns>, 2> Keys{ GenerateKeys() };
+
+	// playerIdx is 0 for the first player, 1 for the second
+	constexpr uint64_t GetKey(int playerIdx, int row, int column) { return Keys[playerIdx][row * NrColumns + column]; }
+}